@@ -1,13 +1,41 @@
 #ifndef __APP_H__
 #define __APP_H__
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include "layout.h"
+
+#define MAX_APP_REGIONS 8
+// maxAge() of data that is only fetched when there is none saved
+#define MAX_AGE_NEVER UINT32_MAX
+
 class IApp {
  public:
   virtual ~IApp() {} //what the heck is this
   //virtual bool fetchData();
   //virtual void render();
+  /* Fetches fresh data into a staging copy. It may run on its own task while
+   * the main task draws, so it must not touch anything render() uses. */
   virtual bool fetchData() = 0;
+  /* Makes the data from the last successful fetchData() what render() draws.
+   * Called from the main task. */
+  virtual void commitData() = 0;
+  /* Sets the region render() draws into, resolved once per cycle */
+  virtual void setRenderArea(const Rect &area) = 0;
   virtual void render() = 0;
+  /* Splits what render() draws into up to MAX_APP_REGIONS regions, each with
+   * a digest of what would be drawn there, so that only the regions that
+   * changed are refreshed. Returns the number of regions. */
+  virtual size_t digestRegions(Rect regions[], uint32_t digests[]) = 0;
+  /* How long fetched data stays fresh, in seconds. The app is only fetched
+   * once its data is this old, 0 fetches it on every wake and MAX_AGE_NEVER
+   * only when nothing was fetched since the last reset. */
+  virtual uint32_t maxAge() = 0;
+  /* Reloads the data kept from the last successful fetch, for wakes where
+   * fetchData() is not due, or failed if stale is set. Stale data is drawn
+   * with a marker. Returns false if there is nothing to show. */
+  virtual bool restoreData(bool stale) = 0;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,19 @@
+#ifndef __ARC_H__
+#define __ARC_H__
+
+#include <Adafruit_GFX.h>
+#include <stdint.h>
+
+/*
+ * Fills the part of the ring around cx,cy between innerRadius (exclusive) and
+ * outerRadius (inclusive) that lies anti-clockwise from the direction
+ * startX,startY to the direction endX,endY, both exclusive. Directions have y
+ * pointing up, as with atan2(). An inner radius of 0 fills a sector.
+ *
+ * Only integer arithmetic is used, and the arc is drawn as horizontal spans.
+ */
+void fillArc(Adafruit_GFX &gfx, int16_t cx, int16_t cy, int16_t startX,
+             int16_t startY, int16_t endX, int16_t endY, int16_t innerRadius,
+             int16_t outerRadius, uint16_t color);
+
+#endif
@@ -1,21 +1,20 @@
 #ifndef __BUS_H__
 #define __BUS_H__
 
-#include <ArduinoJson.h>
 #include <GxEPD2_GFX.h>
 #include <vector>
 
 #include "app.h"
+#include "departures.h"
+#include "display_list.h"
+#include "fetch_session.h"
 #include "renderer.h"
 
-struct stopDescription {
-  const char *name;
-  std::vector<int> iconIds;
-};
+#define MAX_STOPS 6
 
 class Bus : public IApp {
  public:
-  Bus(GxEPD2_GFX &display, Renderer &renderer);
+  Bus(DisplayList &display, Renderer &renderer);
 
   /*
   bool fetchData();
@@ -23,34 +22,43 @@ class Bus : public IApp {
   */
 
   bool fetchData() override;
+  void commitData() override;
   void render() override;
-  void setRenderArea(int16_t x, int16_t y, int16_t w, int16_t h); 
+  size_t digestRegions(Rect regions[], uint32_t digests[]) override;
+  uint32_t maxAge() override;
+  bool restoreData(bool stale) override;
+  void setRenderArea(const Rect &area) override;
 
  private:
-  GxEPD2_GFX &_display;
+  DisplayList &_display;
   Renderer &_renderer;
 
   uint32_t batPercent;
   int wifiRSSI;  // “Received Signal Strength Indicator"
   time_t updateTime;
   time_t nextUpdateTime;
+  bool isStale;  // the departures could not be fetched this cycle
 
-  std::vector<JsonDocument> stopDocs;
+  std::vector<stopDepartures> stops;
+  // Staged by fetchData() until commitData()
+  std::vector<stopDepartures> fetchedStops;
+  time_t fetchTime;
 
-  int16_t _renderX, _renderY, _renderWidth, _renderHeight;  // Rendering area
+  Rect _area;  // Rendering area
 
-  bool fetchForStopId(const char *stopId, JsonDocument &stopDoc);
+  bool fetchForStopId(FetchSession &session, const char *stopId,
+                      stopDepartures &stop);
+  Rect getStopArea(size_t index) const;
+  static uint32_t digestStop(const stopDepartures &stop, time_t now);
   void showBusStopDepartures(int16_t l, int16_t t, int16_t r, int16_t b);
-  int16_t showDeparturesForStop(JsonDocument &stopDoc, int16_t l, int16_t t,
-                                int16_t r, int16_t b);
-  static std::vector<JsonObject> getSortedStopEvents(
-      JsonArray stopEventsJsonArray);
-  static stopDescription getStopDescription(JsonDocument &stopDoc);
+  int16_t showDeparturesForStop(const stopDepartures &stop, int16_t l,
+                                int16_t t, int16_t r, int16_t b);
+  void readStatus();
+  void saveDepartures();
+  bool restoreDepartures(time_t now);
   static const unsigned char *getBitmapForIconId(int16_t iconId);
-  int16_t drawStopEvent(const JsonObject &stopEvent, int16_t l, int16_t t,
+  int16_t drawStopEvent(const Departure &departure, int16_t l, int16_t t,
                         int16_t r, int16_t b);
-  static time_t getDepartureTime(const JsonObject &stopEvent);
-  static time_t parseTimeUtc(const char *utcTimeString);
 };
 
 #endif
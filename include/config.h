@@ -29,6 +29,16 @@ extern const unsigned long NTP_TIMEOUT;
 /* Number of times each hour to refresh the display */
 extern const uint16_t REFRESH_SCHEDULE[24];
 extern const uint32_t DEEP_SLEEP_THRESHOLD;
+/* Show the stops as one time-ordered board instead of one section per stop */
+extern const bool MERGE_STOPS;
+/* Seconds before the weather is fetched again */
+extern const uint32_t WEATHER_MAX_AGE;
+/* Milliseconds the apps have to fetch their data each cycle */
+extern const uint32_t FETCH_CYCLE_BUDGET;
+/* Milliseconds fetches that missed the budget get to finish before deep sleep */
+extern const uint32_t LATE_FETCH_GRACE;
+/* Bytes of internal RAM left free when drawing a whole frame at once */
+extern const uint32_t FULL_FRAME_HEAP_RESERVE;
 extern const uint32_t MAX_BATTERY_VOLTAGE;
 extern const uint32_t WARN_BATTERY_VOLTAGE;
 extern const uint32_t LOW_BATTERY_VOLTAGE;
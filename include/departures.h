@@ -0,0 +1,56 @@
+#ifndef __DEPARTURES_H__
+#define __DEPARTURES_H__
+
+#include <Arduino.h>
+#include <time.h>
+
+#include "top_k.h"
+
+#define MAX_DEPARTURES 4  // departures kept and shown per stop
+#define MAX_STOP_MODES 6
+#define STOP_NAME_LEN 40
+#define ROUTE_NAME_LEN 8
+#define DESTINATION_NAME_LEN 48
+
+struct stopDescription {
+  char name[STOP_NAME_LEN];
+  uint8_t iconIds[MAX_STOP_MODES];  // sorted
+  uint8_t numIconIds;
+};
+
+/* A single departure, decoded from a TfNSW stop event. Only the fields we
+ * render are kept, so the response document never has to be held in memory.
+ */
+struct Departure {
+  char route[ROUTE_NAME_LEN];
+  char destination[DESTINATION_NAME_LEN];
+  time_t departureTime;  // epoch, estimated if realtime otherwise planned
+  bool isRealtime;
+  bool isCancelled;
+  uint8_t iconId;
+};
+
+struct departureEarlier {
+  bool operator()(const Departure &a, const Departure &b) const {
+    return a.departureTime < b.departureTime;
+  }
+};
+
+struct stopDepartures {
+  stopDescription description;
+  // The soonest departures to show, filled in as stop events stream in
+  TopK<Departure, MAX_DEPARTURES, departureEarlier> departures;
+};
+
+/*
+ * Decoding of departure_mon responses, and merging of several stops into one
+ * board. None of it needs the board, so it is also built for the host tests.
+ */
+bool parseDepartures(Stream &stream, stopDepartures &stop, time_t now);
+bool isDepartureShown(const Departure &departure, time_t now);
+void addIconId(stopDescription &desc, int iconId);
+time_t parseTimeUtc(const char *utcTimeString);
+void mergeDepartures(stopDepartures &board, const stopDepartures &stop);
+bool isSameService(const Departure &a, const Departure &b);
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef __DISPLAY_LIST_H__
+#define __DISPLAY_LIST_H__
+
+#include <Adafruit_GFX.h>
+#include <GxEPD2_GFX.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "frame_buffer.h"
+#include "layout.h"
+#include "text_metrics.h"
+
+/*
+ * Records what is drawn on it, so that a frame can be drawn once and then
+ * replayed onto every page of the paged display. Text, layout and data work
+ * is then done once per frame instead of once per page.
+ *
+ * Pixels, lines and rectangles are recorded as filled rectangles, with runs of
+ * pixels along a row merged into one. Bitmaps and text runs are recorded by
+ * reference, so bitmaps and fonts must outlive the list.
+ *
+ * Text is recorded with its foreground colour only and without wrapping, as
+ * it is drawn everywhere in this project.
+ */
+class DisplayList : public Adafruit_GFX {
+ public:
+  DisplayList(int16_t w, int16_t h);
+
+  void clear();
+  void replay(GxEPD2_GFX &target, const Rect &clip) const;
+  void replay(FrameBuffer &target, const Rect &clip) const;
+  size_t size() const { return _ops.size(); }
+  // The box text covers in the current font, from the cursor at 0,0
+  textBounds measureText(const char *text) const {
+    return ::measureText(gfxFont, text, textsize_x);
+  }
+  // The next line of text that fits maxWidth in the current font
+  textLine breakLine(const char *text, uint16_t maxWidth, bool lastLine) const {
+    return ::breakLine(gfxFont, text, maxWidth, lastLine, textsize_x);
+  }
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+  void writePixel(int16_t x, int16_t y, uint16_t color) override;
+  void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                     uint16_t color) override;
+  void writeFastVLine(int16_t x, int16_t y, int16_t h,
+                      uint16_t color) override;
+  void writeFastHLine(int16_t x, int16_t y, int16_t w,
+                      uint16_t color) override;
+  void writeLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                 uint16_t color) override;
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                uint16_t color) override;
+  void fillScreen(uint16_t color) override;
+  void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                uint16_t color) override;
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+  // Recorded as one operation rather than pixel by pixel
+  void drawBitmap(int16_t x, int16_t y, const uint8_t bitmap[], int16_t w,
+                  int16_t h, uint16_t color);
+  // As GxEPD2, draws the pixels whose bits are clear
+  void drawInvertedBitmap(int16_t x, int16_t y, const uint8_t bitmap[],
+                          int16_t w, int16_t h, uint16_t color);
+
+ private:
+  enum opType : uint8_t { OP_FILL_RECT, OP_LINE, OP_BITMAP, OP_INVERTED_BITMAP,
+                          OP_TEXT };
+
+  struct displayOp {
+    opType type;
+    uint8_t textSize;
+    uint16_t color;
+    Rect bounds;  // everything the operation can draw on
+    // Line: the end points. Bitmap: position and size. Text: the cursor, and
+    // the offset and length of the text in _text.
+    int16_t x0, y0, x1, y1;
+    const void *data;  // bitmap or font
+  };
+
+  std::vector<displayOp> _ops;
+  std::vector<char> _text;
+  int16_t _textEndX;  // cursor after the last recorded character
+
+  template <class Target>
+  void replayOnto(Target &target, const Rect &clip) const;
+  void addRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void addChar(uint8_t c, const Rect &glyphBounds);
+};
+
+#endif
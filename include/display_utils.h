@@ -2,11 +2,19 @@
 #ifndef __DISPLAY_UTILS_H__
 #define __DISPLAY_UTILS_H__
 
+#include <stddef.h>
+#include <stdint.h>
 #include <time.h>
 
 #include <vector>
 
+#define FNV1A_OFFSET_BASIS 2166136261u
+
 const char *getWiFiDesc(int rssi);
 const float getWifiFrac(int rssi);
 
+uint32_t fnv1aHash(const void *data, size_t length,
+                   uint32_t hash = FNV1A_OFFSET_BASIS);
+uint32_t fnv1aHash(const char *str, uint32_t hash = FNV1A_OFFSET_BASIS);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,77 @@
+#ifndef __FETCH_EXECUTOR_H__
+#define __FETCH_EXECUTOR_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#if defined(ARDUINO)
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+#include "app.h"
+
+#define MAX_FETCH_TASKS 8
+#define FETCH_TASK_STACK_SIZE 12288  // bytes, enough for a TLS handshake
+
+typedef enum fetchStatus {
+  FETCH_OK,
+  FETCH_FAILED,
+  FETCH_TIMED_OUT
+} fetchStatus_t;
+
+/*
+ * Runs the fetchData() of several apps at the same time, each on its own task
+ * spread across both cores, so a cycle takes as long as the slowest fetch
+ * rather than the sum of them.
+ *
+ * An app that misses the timeout is left to finish in the background, and
+ * run() doesn't start it again until it has. wait() hands back what it fetched
+ * late. Apps only stage what they fetch, so its committed data can still be
+ * drawn meanwhile. Each app keeps the same task slot across runs, so there is
+ * room for MAX_FETCH_TASKS apps.
+ *
+ * Off the device, tasks are std::threads so the timing can be measured on the
+ * host.
+ */
+class FetchExecutor {
+ public:
+  FetchExecutor();
+
+  void run(IApp *const apps[], size_t numApps, uint32_t timeoutMs,
+           fetchStatus_t statuses[]);
+  size_t wait(uint32_t timeoutMs, IApp *lateApps[], time_t finishTimes[]);
+  size_t numRunning() const;
+
+ private:
+  struct fetchTask {
+    FetchExecutor *executor;
+    IApp *app;  // NULL until an app is first run in this slot
+    uint8_t index;
+    bool result;
+    time_t finishTime;
+    bool done;
+    bool running;  // started and not yet seen to finish by the caller's task
+  };
+
+  fetchTask _tasks[MAX_FETCH_TASKS];
+
+  fetchTask *taskFor(IApp *app);
+  bool start(fetchTask &task);
+  void finish(fetchTask &task, bool result);
+  uint32_t waitForTasks(uint32_t mask, uint32_t timeoutMs);
+
+#if defined(ARDUINO)
+  EventGroupHandle_t _done;
+  static void taskMain(void *param);
+#else
+  std::mutex _lock;
+  std::condition_variable _changed;
+#endif
+};
+
+#endif
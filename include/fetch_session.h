@@ -0,0 +1,36 @@
+#ifndef __FETCH_SESSION_H__
+#define __FETCH_SESSION_H__
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+
+#include "http_body_stream.h"
+#include "tls_session_client.h"
+
+/*
+ * Keeps one TLS connection open across several requests to the same host, so
+ * only the first request of a fetch cycle pays for the handshake.
+ */
+class FetchSession {
+ public:
+  FetchSession();
+  ~FetchSession();
+
+  int get(const char *url, const char *authType = NULL,
+          const char *auth = NULL);
+  Stream &getStream() { return _body; }
+  int getSize() { return _http.getSize(); }
+  String errorToString(int httpCode) { return _http.errorToString(httpCode); }
+  void end(bool reuse = true);
+  void close();
+
+ private:
+  TlsSessionClient _client;
+  HTTPClient _http;
+  HttpBodyStream _body;
+  uint16_t _numRequests;
+  uint32_t _totalLatency;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef __FRAME_BUFFER_H__
+#define __FRAME_BUFFER_H__
+
+#include <Adafruit_GFX.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "layout.h"
+
+/*
+ * A 1 bit buffer for the whole panel, so a frame can be drawn in one pass and
+ * sent to the panel in one go instead of page by page.
+ *
+ * The buffer has the same layout as the GxEPD2 page buffer: rows of the
+ * unrotated panel, 8 pixels to a byte with the leftmost in the top bit, and a
+ * set bit for white. Rotation works as it does for GxEPD2_BW.
+ *
+ * The buffer is only allocated while a frame is drawn, so the memory is free
+ * for fetching the rest of the time.
+ *
+ * Rectangles are filled a byte at a time in any rotation. Bitmaps are copied
+ * a byte at a time unrotated and in rotation 3 (portrait, as the display is
+ * used), and pixel by pixel otherwise or where they run off the buffer.
+ */
+class FrameBuffer : public Adafruit_GFX {
+ public:
+  FrameBuffer(int16_t w, int16_t h);
+  ~FrameBuffer();
+
+  bool allocate(size_t heapReserve);
+  void release();
+  bool allocated() const { return _buffer != NULL; }
+  const uint8_t *buffer() const { return _buffer; }
+  size_t bufferSize() const { return (size_t)(WIDTH + 7) / 8 * HEIGHT; }
+  bool inPsram() const { return _inPsram; }
+  Rect toPanel(const Rect &area) const;
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+  void fillScreen(uint16_t color) override;
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                uint16_t color) override;
+  void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                     uint16_t color) override;
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+  void writeFastVLine(int16_t x, int16_t y, int16_t h,
+                      uint16_t color) override;
+  void writeFastHLine(int16_t x, int16_t y, int16_t w,
+                      uint16_t color) override;
+  // Draws the pixels whose bits are set
+  void drawBitmap(int16_t x, int16_t y, const uint8_t bitmap[], int16_t w,
+                  int16_t h, uint16_t color);
+  // As GxEPD2, draws the pixels whose bits are clear
+  void drawInvertedBitmap(int16_t x, int16_t y, const uint8_t bitmap[],
+                          int16_t w, int16_t h, uint16_t color);
+
+ private:
+  uint8_t *_buffer;
+  bool _inPsram;
+
+  void blit(int16_t x, int16_t y, const uint8_t bitmap[], int16_t w,
+            int16_t h, uint16_t color, bool inverted);
+  void fillSpan(int16_t row, int16_t x, int16_t w, uint16_t color);
+  void writeBits(int16_t row, int16_t x, uint8_t bits, uint16_t color);
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef __HTTP_BODY_STREAM_H__
+#define __HTTP_BODY_STREAM_H__
+
+#include <Arduino.h>
+#include <Client.h>
+
+/*
+ * The body of a single HTTP/1.1 response. Decodes chunked transfer encoding
+ * and stops at the end of the body, so the connection it is read from can be
+ * reused for the next request.
+ */
+class HttpBodyStream : public Stream {
+ public:
+  HttpBodyStream(Client &upstream);
+
+  void reset(int contentLength, bool chunked);
+  bool finished() const { return _finished; }
+  bool drain();
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  using Stream::readBytes;
+  size_t readBytes(char *buffer, size_t length) override;
+  size_t write(uint8_t) override { return 0; }
+  void flush() override {}
+
+ private:
+  Client &_upstream;
+  bool _chunked;
+  bool _finished;
+  bool _firstChunk;
+  bool _broken;  // the chunk framing could not be parsed
+  int32_t _remaining;  // bytes left in the body or chunk, -1 if unknown
+
+  bool nextChunk();
+  int upstreamRead();
+};
+
+#endif
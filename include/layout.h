@@ -0,0 +1,42 @@
+#ifndef __LAYOUT_H__
+#define __LAYOUT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct Rect {
+  int16_t x;
+  int16_t y;
+  int16_t w;
+  int16_t h;
+
+  int16_t right() const { return x + w; }
+  int16_t bottom() const { return y + h; }
+  bool empty() const { return w <= 0 || h <= 0; }
+  bool intersects(const Rect &other) const {
+    return x < other.right() && other.x < right() && y < other.bottom() &&
+           other.y < bottom();
+  }
+  bool operator==(const Rect &other) const {
+    return x == other.x && y == other.y && w == other.w && h == other.h;
+  }
+  bool operator!=(const Rect &other) const { return !(*this == other); }
+
+  Rect unite(const Rect &other) const;
+  Rect intersect(const Rect &other) const;
+  Rect alignedTo(int16_t n) const;
+};
+
+/*
+ * One region of a screen split from top to bottom. Each region gets at least
+ * minHeight, and the height left over is shared out in proportion to weight.
+ */
+struct layoutRegion {
+  uint8_t weight;
+  int16_t minHeight;
+};
+
+void resolveLayout(const Rect &area, const layoutRegion regions[],
+                   size_t numRegions, Rect resolved[]);
+
+#endif
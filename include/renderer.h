@@ -8,36 +8,54 @@
 #include <vector>
 
 #include "config.h"
+#include "display_list.h"
+#include "status_icons.h"
 
 typedef enum alignment { LEFT, RIGHT, CENTER } alignment_t;
 
+#define STATUS_BAR_HEIGHT 18
+#define STATUS_ICON_SPRITES 4  // levels of each status bar icon kept drawn
+
+// A status bar icon drawn at one level, so drawing it again is a single blit
+struct iconSprite {
+  int16_t level;  // -1 if nothing has been drawn into it
+  uint8_t bitmap[STATUS_ICON_BYTES];
+};
+
 class Renderer {
  public:
-  Renderer(GxEPD2_GFX &display);
+  Renderer(DisplayList &display);
 
   uint16_t getStringWidth(const String &text);
   uint16_t getStringHeight(const String &text);
   void drawString(int16_t x, int16_t y, const String &text,
                   alignment_t alignment);
-  int16_t drawMultiLnString(int16_t x, int16_t y, const String &text,
+  int16_t drawMultiLnString(int16_t x, int16_t y, const char *text,
                             alignment_t alignment, uint16_t max_width,
                             uint16_t max_lines, int16_t line_spacing);
 
-  void drawArc(int16_t cx, int16_t cy, double startAngle, double endAngle,
-               int16_t innerRadius, int16_t outerRadius);
-
-  int16_t drawStatusBar(int16_t yBaseline, time_t lastUpdatedTime, int rssi,
-                        uint32_t batPercent);
+  int16_t drawStatusBar(int16_t xRight, int16_t yBaseline,
+                        time_t lastUpdatedTime, int rssi, uint32_t batPercent);
   void drawError(const uint8_t *bitmap_192x192, const String &errMsgLn1,
                  const String &errMsgLn2 = "");
+  void drawError(const Rect &area, const uint8_t *bitmap_192x192,
+                 const String &errMsgLn1, const String &errMsgLn2 = "");
+  void drawStaleMarker(int16_t x, int16_t yBaseline, alignment_t alignment);
 
  private:
-  GxEPD2_GFX &_display;
+  DisplayList &_display;
+
+  void drawErrorAt(int16_t x, int16_t y, uint16_t maxWidth,
+                   const uint8_t *bitmap_192x192, const String &errMsgLn1,
+                   const String &errMsgLn2);
+
+  iconSprite _batterySprites[STATUS_ICON_SPRITES];
+  iconSprite _wifiSprites[STATUS_ICON_SPRITES];
 
-  void drawBattery(int16_t x, int16_t y, int16_t w, int16_t h,
-                   uint32_t batPercent);
-  void drawWifi(int16_t x, int16_t y, int16_t w, int16_t h, int rssi);
-  static boolean isAngleInArc(double angle, double startAngle, double endAngle);
+  void drawTextLine(int16_t x, int16_t y, const char *text,
+                    const textLine &line, alignment_t alignment);
+  void drawSprite(iconSprite sprites[], drawIcon_t draw, int16_t level,
+                  int16_t x, int16_t y);
 };
 
 #endif
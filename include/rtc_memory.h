@@ -0,0 +1,29 @@
+#ifndef __RTC_MEMORY_H__
+#define __RTC_MEMORY_H__
+
+#include <sdkconfig.h>
+
+/*
+ * Everything kept across deep sleep with RTC_DATA_ATTR shares the 8 KB of RTC
+ * slow memory, less what is reserved for the ULP coprocessor. Each module that
+ * keeps data there gets a share below and checks the size of its data against
+ * it, so adding to one of them can't silently crowd out the others.
+ */
+#define RTC_SLOW_MEMORY_SIZE 8192
+#ifdef CONFIG_ULP_COPROC_RESERVE_MEM
+#define RTC_ULP_RESERVE CONFIG_ULP_COPROC_RESERVE_MEM
+#else
+#define RTC_ULP_RESERVE 0
+#endif
+
+#define RTC_TLS_SESSIONS_SHARE 4224  // two cached sessions, tls_session_client
+#define RTC_BUS_SHARE 2112           // saved departures, bus
+#define RTC_WEATHER_SHARE 256        // saved weather report, weather
+#define RTC_MAIN_SHARE 256           // last fetches and digests, main
+
+static_assert(RTC_TLS_SESSIONS_SHARE + RTC_BUS_SHARE + RTC_WEATHER_SHARE +
+                      RTC_MAIN_SHARE <=
+                  RTC_SLOW_MEMORY_SIZE - RTC_ULP_RESERVE,
+              "RTC_DATA_ATTR shares don't fit in RTC slow memory");
+
+#endif
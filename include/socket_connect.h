@@ -0,0 +1,8 @@
+#ifndef __SOCKET_CONNECT_H__
+#define __SOCKET_CONNECT_H__
+
+#include <stdint.h>
+
+int connectSocket(const char *host, uint16_t port, int32_t timeout);
+
+#endif
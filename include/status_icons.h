@@ -0,0 +1,29 @@
+#ifndef __STATUS_ICONS_H__
+#define __STATUS_ICONS_H__
+
+#include <Adafruit_GFX.h>
+#include <stdint.h>
+
+#define STATUS_ICON_SIZE 18
+#define STATUS_ICON_BYTES ((STATUS_ICON_SIZE + 7) / 8 * STATUS_ICON_SIZE)
+
+/*
+ * The status bar icons, each drawn at a level that is all that changes with
+ * the reading it shows, so that a level can be drawn once and kept. None of
+ * it needs the board, so it is also built for the host tests.
+ */
+
+// Draws an icon at x,y in a w by h box, at a level worked out for that size
+typedef void (*drawIcon_t)(Adafruit_GFX &gfx, int16_t x, int16_t y, int16_t w,
+                           int16_t h, int16_t level);
+
+void drawIconSprite(uint8_t bitmap[], drawIcon_t draw, int16_t level);
+
+int16_t batteryLevel(int16_t w, uint32_t batPercent);
+void drawBattery(Adafruit_GFX &gfx, int16_t x, int16_t y, int16_t w,
+                 int16_t h, int16_t emptyLength);
+int16_t wifiLevel(int16_t w, int16_t h, int rssi);
+void drawWifi(Adafruit_GFX &gfx, int16_t x, int16_t y, int16_t w, int16_t h,
+              int16_t wifiRadius);
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef __TEXT_METRICS_H__
+#define __TEXT_METRICS_H__
+
+#include <Adafruit_GFX.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The box that text covers when drawn with the cursor at 0,0. Empty text has
+ * a zero size.
+ */
+struct textBounds {
+  int16_t x;
+  int16_t y;
+  uint16_t w;
+  uint16_t h;
+};
+
+/*
+ * Measures unwrapped text straight from the font's glyph table, giving the
+ * same box as Adafruit_GFX::getTextBounds() without going through a display.
+ * A NULL font is the built in 6x8 font.
+ */
+textBounds measureText(const GFXfont *font, const char *text,
+                       uint8_t size = 1);
+textBounds measureText(const GFXfont *font, const char *begin,
+                       const char *end, uint8_t size = 1);
+
+/*
+ * One line of text broken to fit a width. The line is the text up to end,
+ * followed by "..." if ellipsis is set, and is width pixels wide as drawn.
+ * The line after it starts at next.
+ */
+struct textLine {
+  const char *end;
+  const char *next;
+  uint16_t width;
+  bool ellipsis;
+};
+
+textLine breakLine(const GFXfont *font, const char *text, uint16_t maxWidth,
+                   bool lastLine, uint8_t size = 1);
+
+#endif
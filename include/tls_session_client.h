@@ -0,0 +1,29 @@
+#ifndef __TLS_SESSION_CLIENT_H__
+#define __TLS_SESSION_CLIENT_H__
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+
+#define TLS_SESSION_CACHE_ENTRIES 2
+#define TLS_SESSION_HOST_LEN 40
+#define TLS_SESSION_MAX_SIZE 2048  // larger sessions are logged, not cached
+
+/*
+ * A WiFiClientSecure that offers the server the TLS session from its last
+ * connection to the same host. Sessions are kept in RTC memory, so the first
+ * connection after a wake from deep sleep can resume a session instead of
+ * doing a full handshake.
+ *
+ * Like the clients it replaces, the server certificate is not verified.
+ */
+class TlsSessionClient : public WiFiClientSecure {
+ public:
+  using WiFiClientSecure::connect;
+  int connect(const char *host, uint16_t port);
+  int connect(const char *host, uint16_t port, int32_t timeout);
+
+ private:
+  bool handshake(const char *host, uint16_t port);
+};
+
+#endif
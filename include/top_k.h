@@ -0,0 +1,49 @@
+#ifndef __TOP_K_H__
+#define __TOP_K_H__
+
+#include <stddef.h>
+
+#include <functional>
+
+/*
+ * Keeps the K smallest of the values pushed into it, in ascending order.
+ * Memory use is fixed at K values no matter how many are pushed, and each
+ * push is an insertion into at most K values.
+ */
+template <typename T, size_t K, typename Less = std::less<T>>
+class TopK {
+ public:
+  TopK() : _size(0) {}
+
+  /*
+   * Returns true if the value was kept. Values equal to one already kept go
+   * after it, so the order of equal values is the order they were pushed.
+   */
+  bool push(const T &value) {
+    Less less;
+    if (_size == K && !less(value, _values[K - 1])) {
+      return false;
+    }
+    size_t i = _size < K ? _size++ : K - 1;
+    for (; i > 0 && less(value, _values[i - 1]); i--) {
+      _values[i] = _values[i - 1];
+    }
+    _values[i] = value;
+    return true;
+  }
+
+  void clear() { _size = 0; }
+  size_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+  static constexpr size_t capacity() { return K; }
+
+  const T &operator[](size_t i) const { return _values[i]; }
+  const T *begin() const { return _values; }
+  const T *end() const { return _values + _size; }
+
+ private:
+  T _values[K];
+  size_t _size;
+};
+
+#endif
@@ -6,44 +6,45 @@
 #include <GxEPD2_GFX.h>
 #include "renderer.h"
 #include "app.h"
-
+#include "display_list.h"
+#include "fetch_session.h"
+#include "weather_report.h"
 
 class Weather : public IApp {
 public:
-    Weather(GxEPD2_GFX& display, Renderer& renderer);
+    Weather(DisplayList& display, Renderer& renderer);
     
     // IApp interface methods
     bool fetchData() override;
+    void commitData() override;
     void render() override;
+    size_t digestRegions(Rect regions[], uint32_t digests[]) override;
+    uint32_t maxAge() override;
+    bool restoreData(bool stale) override;
 
     // Method to set rendering area
-    void setRenderArea(int16_t x, int16_t y, int16_t w, int16_t h);
+    void setRenderArea(const Rect& area) override;
 
 
 private:
-    GxEPD2_GFX& _display;
+    DisplayList& _display;
     Renderer& _renderer;
 
     // Rendering area
-    /*
-    int16_t _renderX;
-    int16_t _renderY;
-    int16_t _renderWidth;
-    int16_t _renderHeight;
-    */
-    int16_t _renderX, _renderY, _renderWidth, _renderHeight;    
+    Rect _area;
 
     // Weather data
-    String cityName;
-    float temperature;
-    float feelsLike;
-    int humidity;
-    String weatherDescription;
-    String weatherIconCode;
+    weatherReport report;
+    weatherReport fetchedReport;  // staged by fetchData() until commitData()
+    bool isStale;  // the weather could not be fetched when it was due
+    bool isForecastStale;  // the last forecast fetched, kept when one fails
+    bool forecastFailed;  // staged by fetchData() until commitData()
 
     // Private methods
-    bool fetchWeatherData();
+    bool fetchWeatherData(FetchSession& session);
+    bool fetchForecast(FetchSession& session);
     void drawWeatherIcon(int16_t x, int16_t y);
+    void drawForecast(int16_t x, int16_t y, int16_t w, int16_t h);
 
     // You might want to add these methods if you need more flexibility in rendering
     void renderWeather(int16_t x, int16_t y, int16_t w, int16_t h);
@@ -7,28 +7,23 @@
 #define WEATHER_ICON_WIDTH 32
 #define WEATHER_ICON_HEIGHT 32
 
-// Declare extern arrays for each weather icon
-extern const unsigned char epd_bitmap_sunny[];
-extern const unsigned char epd_bitmap_partly_cloudy[];
+// Bytes in each icon bitmap, each row padded to whole bytes
+#define WEATHER_ICON_BYTES ((WEATHER_ICON_WIDTH + 7) / 8 * WEATHER_ICON_HEIGHT)
+
 extern const unsigned char epd_bitmap_clear_sky[];
-extern const unsigned char epd_bitmap_few_clouds[];
-
-extern const unsigned char epd_bitmap_cloudy[];
-extern const unsigned char epd_bitmap_rain[];
-extern const unsigned char epd_bitmap_thunderstorm[];
-extern const unsigned char epd_bitmap_snow[];
-extern const unsigned char epd_bitmap_mist[];
-extern const unsigned char epd_bitmap_fog[];
-extern const unsigned char epd_bitmap_light_rain[];
-extern const unsigned char epd_bitmap_heavy_rain[];
-extern const unsigned char epd_bitmap_sleet[];
-extern const unsigned char epd_bitmap_light_snow[];
-extern const unsigned char epd_bitmap_heavy_snow[];
-extern const unsigned char epd_bitmap_tornado[];
-extern const unsigned char epd_bitmap_windy[];
+
+// What an OpenWeather icon code (e.g. "10d") is drawn as
+struct weatherIconInfo {
+    const unsigned char* bitmap;
+    const char* label;
+    bool isNight;
+};
+
+// Look up an OpenWeather icon code, returns nullptr for unknown codes
+const weatherIconInfo* getWeatherIcon(const char* iconCode);
 
 // Function to get the appropriate bitmap based on the OpenWeather icon code
-const unsigned char* getWeatherBitmap(const String& iconCode);
+const unsigned char* getWeatherBitmap(const char* iconCode);
 
 // Optional: You can add more utility functions here if needed
 // For example:
@@ -0,0 +1,44 @@
+#ifndef WEATHER_REPORT_H
+#define WEATHER_REPORT_H
+
+#include <Arduino.h>
+#include <time.h>
+
+#define CITY_NAME_LEN 32
+#define WEATHER_DESCRIPTION_LEN 48
+#define WEATHER_ICON_CODE_LEN 4
+#define FORECAST_POINTS 24  // 3 days of the 3 hourly forecast
+
+// One forecast step, in fixed point so the whole forecast stays small
+struct __attribute__((packed)) forecastPoint {
+    int16_t temperature;  // tenths of a degree Celsius
+    uint8_t pop;          // probability of precipitation, percent
+};
+
+// Evenly spaced forecast steps, starting at startTime
+struct forecastPoints {
+    time_t startTime;
+    uint32_t interval;  // seconds between points
+    uint8_t numPoints;
+    forecastPoint points[FORECAST_POINTS];
+};
+
+// Everything fetched from OpenWeather that is drawn
+struct weatherReport {
+    char cityName[CITY_NAME_LEN];
+    float temperature;
+    float feelsLike;
+    int humidity;
+    char weatherDescription[WEATHER_DESCRIPTION_LEN];
+    char weatherIconCode[WEATHER_ICON_CODE_LEN];  // e.g. "10d"
+    forecastPoints forecast;
+};
+
+/*
+ * Decoding of OpenWeather responses. None of it needs the board, so it is
+ * also built for the host tests.
+ */
+bool parseWeather(Stream& stream, weatherReport& result);
+bool parseForecast(Stream& stream, forecastPoints& result);
+
+#endif // WEATHER_REPORT_H
@@ -0,0 +1,87 @@
+#include "arc.h"
+
+/*
+ * Returns the largest r with r * r <= n.
+ */
+static int32_t isqrt(int32_t n) {
+  int32_t r = 0;
+  int32_t bit = (int32_t)1 << 30;
+  while (bit > n) {
+    bit >>= 2;
+  }
+  while (bit != 0) {
+    if (n >= r + bit) {
+      n -= r + bit;
+      r = (r >> 1) + bit;
+    } else {
+      r >>= 1;
+    }
+    bit >>= 2;
+  }
+  return r;
+}
+
+/*
+ * Fills the runs of row y between x0 and x1 (inclusive, relative to the
+ * centre) that are inside the angle. The tests are the signs of the cross
+ * products with each edge, so a pixel on an edge is outside, as it is for the
+ * strict comparison of atan2() angles.
+ */
+static void fillRowSpans(Adafruit_GFX &gfx, int16_t cx, int16_t cy, int16_t y,
+                         int16_t x0, int16_t x1, int16_t startX,
+                         int16_t startY, int16_t endX, int16_t endY,
+                         bool reflex, uint16_t color) {
+  const int32_t py = -y;
+  int16_t runStart = 0;
+  bool inRun = false;
+  for (int16_t x = x0; x <= x1; x++) {
+    bool afterStart = (int32_t)startX * py - (int32_t)startY * x > 0;
+    bool beforeEnd = (int32_t)x * endY - py * endX > 0;
+    bool inside = reflex ? afterStart || beforeEnd : afterStart && beforeEnd;
+    if (inside && !inRun) {
+      runStart = x;
+      inRun = true;
+    } else if (!inside && inRun) {
+      gfx.drawFastHLine(cx + runStart, cy + y, x - runStart, color);
+      inRun = false;
+    }
+  }
+  if (inRun) {
+    gfx.drawFastHLine(cx + runStart, cy + y, x1 + 1 - runStart, color);
+  }
+}
+
+void fillArc(Adafruit_GFX &gfx, int16_t cx, int16_t cy, int16_t startX,
+             int16_t startY, int16_t endX, int16_t endY, int16_t innerRadius,
+             int16_t outerRadius, uint16_t color) {
+  const int32_t sweep = (int32_t)startX * endY - (int32_t)startY * endX;
+  const int32_t dot = (int32_t)startX * endX + (int32_t)startY * endY;
+  if (sweep == 0 && dot > 0) {
+    return;  // the start and end are the same direction
+  }
+  // More than half a turn, so a pixel only needs to be on the inside of one
+  // of the edges
+  const bool reflex = sweep < 0;
+
+  const int32_t outer2 = (int32_t)outerRadius * outerRadius;
+  const int32_t inner2 = (int32_t)innerRadius * innerRadius;
+  for (int16_t y = -outerRadius; y <= outerRadius; y++) {
+    const int32_t y2 = (int32_t)y * y;
+    const int16_t xOuter = isqrt(outer2 - y2);
+    if (inner2 - y2 < 0) {
+      // The row misses the hole
+      fillRowSpans(gfx, cx, cy, y, -xOuter, xOuter, startX, startY, endX,
+                   endY, reflex, color);
+      continue;
+    }
+    // Pixels must be further out than the hole, on both sides of it
+    const int16_t xInner = isqrt(inner2 - y2);
+    if (xInner >= xOuter) {
+      continue;
+    }
+    fillRowSpans(gfx, cx, cy, y, -xOuter, -xInner - 1, startX, startY, endX,
+                 endY, reflex, color);
+    fillRowSpans(gfx, cx, cy, y, xInner + 1, xOuter, startX, startY, endX,
+                 endY, reflex, color);
+  }
+}
@@ -3,7 +3,6 @@
 #include "bus.h"
 
 #include <Arduino.h>
-#include <ArduinoJson.h>
 #include <Fonts/FreeMonoBold24pt7b.h>
 #include <Fonts/FreeMonoBold9pt7b.h>
 #include <Fonts/FreeSans9pt7b.h>
@@ -18,8 +17,13 @@
 
 #include "bus_icons.h"
 #include "client_utils.h"
+#include "departures.h"
+#include "display_utils.h"
+#include "fetch_session.h"
 #include "renderer.h"
+#include "rtc_memory.h"
 #include "secrets.h"
+#include "text_metrics.h"
 
 // const char *stopIds[] = {"200060"};  // Central
 // const char *stopIds[] = {"200020"};  // Circular Quay
@@ -32,29 +36,101 @@ const char *stopIds[] = {"2196291"};  // Punchbowl - citybound
 // const char *stopIds[] = {"2196291", "2196292", "2196275"};  // Punchbowl citybound, west, & bus stop
 //const char *stopIds[] = {"2035144", "2035159"};  // Maroubra
 
-Bus::Bus(GxEPD2_GFX &_display, Renderer &renderer)
-    : _display(_display), _renderer(renderer) {}
+// The last fetched departures, kept across deep sleep so that wakes without a
+// fetch can still count down to the departures that haven't left yet
+struct savedDepartures {
+  time_t fetchTime;
+  int wifiRSSI;  // when WiFi was last up, for wakes that don't bring it up
+  uint8_t numStops;
+  stopDescription descriptions[MAX_STOPS];
+  uint8_t numDepartures[MAX_STOPS];
+  Departure departures[MAX_STOPS][MAX_DEPARTURES];
+};
+RTC_DATA_ATTR static savedDepartures saved;
+static_assert(sizeof(saved) <= RTC_BUS_SHARE,
+              "saved departures outgrow RTC_BUS_SHARE");
+
+Bus::Bus(DisplayList &_display, Renderer &renderer)
+    : _display(_display), _renderer(renderer), isStale(false), _area{} {}
 
 bool Bus::fetchData() {
-  // WIFI
-  wifiRSSI = WiFi.RSSI();  // get WiFi signal strength now, because the WiFi
-                           // will be turned off to save power!
+  fetchedStops.clear();
+  fetchTime = time(NULL);
+
+  // All stops are fetched over the same connection. When merging, each stop
+  // is folded into the board as soon as it is parsed, so only one stop's
+  // departures are held besides the board itself.
+  FetchSession session;
+  stopDepartures merged;
+  merged.description = {};
+  for (const char *stopId : stopIds) {
+    if (!MERGE_STOPS && fetchedStops.size() == MAX_STOPS) {
+      Serial.printf("Only showing the first %d stops, increase MAX_STOPS\n",
+                    MAX_STOPS);
+      break;
+    }
+    stopDepartures stop;
+    if (!fetchForStopId(session, stopId, stop)) {
+      return false;
+    }
+    if (MERGE_STOPS) {
+      mergeDepartures(merged, stop);
+    } else {
+      fetchedStops.push_back(std::move(stop));
+    }
+  }
+  if (MERGE_STOPS) {
+    fetchedStops.push_back(merged);
+  }
+  return true;
+}
+
+void Bus::commitData() {
+  readStatus();
+  stops = std::move(fetchedStops);
+  fetchedStops.clear();
+  updateTime = fetchTime;
+  isStale = false;
+  saveDepartures();
+}
+
+/*
+ * Departures are fetched on every wake, except ahead of a long sleep, when the
+ * saved departures are counted down instead.
+ */
+uint32_t Bus::maxAge() {
+  return calculateSleepDuration() > 5 * 60 ? MAX_AGE_NEVER : 0;
+}
 
+/*
+ * Restores the saved departures. An empty board still shows when the next
+ * update is, so there is always something to show.
+ */
+bool Bus::restoreData(bool stale) {
+  readStatus();
   updateTime = time(NULL);
+  nextUpdateTime = updateTime + calculateSleepDuration();
+  isStale = stale;
+  stops.clear();
+  if (!restoreDepartures(updateTime)) {
+    Serial.println("No saved departures left to show");
+  }
+  return true;
+}
 
-  stopDocs.clear();
-  uint64_t sleepDuration = calculateSleepDuration();
-  if (calculateSleepDuration() > 5 * 60) {
-    nextUpdateTime = updateTime + sleepDuration;
-    Serial.println("Skipping data fetch");
+/*
+ * Reads the WiFi signal strength and battery level for the status bar. WiFi is
+ * only up on wakes with something to fetch, the others show the strength from
+ * the last wake it was, so the status bar doesn't change while it is off.
+ */
+void Bus::readStatus() {
+  // WIFI
+  if (WiFi.status() == WL_CONNECTED) {
+    wifiRSSI = WiFi.RSSI();  // get WiFi signal strength now, because the WiFi
+                             // will be turned off to save power!
+    saved.wifiRSSI = wifiRSSI;
   } else {
-    for (const char *stopId : stopIds) {
-      JsonDocument stopDoc;
-      if (!fetchForStopId(stopId, stopDoc)) {
-        return false;
-      }
-      stopDocs.push_back(stopDoc);
-    }
+    wifiRSSI = saved.wifiRSSI;
   }
 
   // BATTERY
@@ -62,20 +138,53 @@ bool Bus::fetchData() {
   batPercent =
       calcBatPercent(batVoltage, CRIT_LOW_BATTERY_VOLTAGE, MAX_BATTERY_VOLTAGE);
   Serial.printf("Bat voltage: %d percent: %d\n", batVoltage, batPercent);
+}
 
-  return true;
+
+void Bus::saveDepartures() {
+  saved.fetchTime = updateTime;
+  saved.numStops = stops.size();
+  for (int i = 0; i < saved.numStops; i++) {
+    saved.descriptions[i] = stops[i].description;
+    saved.numDepartures[i] = stops[i].departures.size();
+    std::copy(stops[i].departures.begin(), stops[i].departures.end(),
+              saved.departures[i]);
+  }
 }
 
+/*
+ * Restores the last fetched departures, dropping those that have already
+ * left. The countdowns are drawn relative to now, so they stay correct.
+ *
+ * Returns false if there are no departures left to show.
+ */
+bool Bus::restoreDepartures(time_t now) {
+  bool anyDepartures = false;
+  for (int i = 0; i < saved.numStops; i++) {
+    stopDepartures stop;
+    stop.description = saved.descriptions[i];
+    for (int j = 0; j < saved.numDepartures[i]; j++) {
+      if (saved.departures[i][j].departureTime >= now) {
+        stop.departures.push(saved.departures[i][j]);
+      }
+    }
+    anyDepartures |= !stop.departures.empty();
+    stops.push_back(stop);
+  }
+  if (!anyDepartures) {
+    stops.clear();
+    return false;
+  }
 
-bool Bus::fetchForStopId(const char *stopId, JsonDocument &stopDoc) {
-  uint32_t start = millis();
-  WiFiClientSecure client;
-  HTTPClient http;
+  updateTime = saved.fetchTime;
+  Serial.printf("Showing departures fetched %ld seconds ago\n",
+                (long)(now - saved.fetchTime));
+  return true;
+}
 
+bool Bus::fetchForStopId(FetchSession &session, const char *stopId,
+                         stopDepartures &stop) {
   // Construct the http request
-  http.useHTTP10(true);
-  http.setAuthorizationType("apiKey");
-  http.setAuthorization(TFNSW_API_KEY);
   char url[256];
   snprintf(
       url, sizeof(url),
@@ -86,120 +195,153 @@ bool Bus::fetchForStopId(const char *stopId, JsonDocument &stopDoc) {
       "&departureMonitorMacro=true&excludedMeans=11&TfNSWDM="
       "true&version=10.2.1.42",
       stopId);
-  http.begin(url, (const char *)NULL);
 
   // Send the request as a GET
-  int http_code = http.GET();
+  int http_code = session.get(url, "apiKey", TFNSW_API_KEY);
 
-  Serial.printf("Finished request in %lu millis.\n", millis() - start);
   if (http_code > 0) {
     Serial.printf("Response code: %d Data length: %d\n", http_code,
-                  http.getSize());
-
-    // The filter: it contains "true" for each value we want to keep
-    JsonDocument filter;
-    filter["locations"][0]["disassembledName"] = true;
-    filter["locations"][0]["assignedStops"][0]["modes"] = true;
-    filter["stopEvents"][0]["departureTimePlanned"] = true;
-    filter["stopEvents"][0]["departureTimeEstimated"] = true;
-    filter["stopEvents"][0]["isRealtimeControlled"] = true;
-    filter["stopEvents"][0]["isCancelled"] = true;
-    filter["stopEvents"][0]["location"]["parent"]["disassembledName"] = true;
-    filter["stopEvents"][0]["transportation"]["disassembledName"] = true;
-    filter["stopEvents"][0]["transportation"]["product"]["iconId"] = true;
-    filter["stopEvents"][0]["transportation"]["origin"]["name"] = true;
-    filter["stopEvents"][0]["transportation"]["destination"]["name"] = true;
-
-    DeserializationError err = deserializeJson(
-        stopDoc, http.getStream(), DeserializationOption::Filter(filter));
-
-    if (err) {
-      Serial.printf("Error parsing response! %s\n", err.c_str());
-      http.end();
+                  session.getSize());
+
+    // Reading the TLS client a byte at a time is slow, so read it in blocks.
+    // The body stream never reports more than is left of the body, so the
+    // buffer can't read ahead into the next response.
+    ReadBufferingStream bufferedStream(session.getStream(), 256);
+    // A stall longer than the default 1s timeout would otherwise truncate the
+    // document and fail with IncompleteInput
+    bufferedStream.setTimeout(HTTPCLIENT_DEFAULT_TCP_TIMEOUT);
+
+    uint32_t freeHeapBefore = ESP.getFreeHeap();
+    uint32_t parseStart = millis();
+    bool parsed = parseDepartures(bufferedStream, stop, time(NULL));
+    session.end(parsed);
+    if (!parsed) {
       return false;
     }
 
-    Serial.println("Parsing successful");
-    http.end();
-
-    // For some reason, this is necessary otherwise we get an IncompleteInput
-    // error. This must affect compilation in some way that makes the code
-    // work.
-    serializeJsonPretty(stopDoc, Serial);
-
+    Serial.printf("Kept %u departures in %lu millis, heap used: %d bytes\n",
+                  stop.departures.size(), millis() - parseStart,
+                  (int)freeHeapBefore - (int)ESP.getFreeHeap());
     return true;
   } else {
     Serial.printf("Error on HTTP request (%d): %s\n", http_code,
-                  http.errorToString(http_code).c_str());
-    http.end();
+                  session.errorToString(http_code).c_str());
+    session.end(false);
     return false;
   }
 }
 
-void Bus::setRenderArea(int16_t x, int16_t y, int16_t w, int16_t h) {
-    // bus.setRenderArea(X_MARGIN (28), display.height() / 2 , display.width() - X_MARGIN (28) , display.height() - Y_MARGIN (64));
-    // x = 28, y = 400, w = 370, h = 736
+void Bus::setRenderArea(const Rect &area) { _area = area; }
 
-    _renderX = x;
-    _renderY = y;
-    _renderWidth = w;
-    _renderHeight = h;
+void Bus::render() {
+  showBusStopDepartures(_area.x, _area.y, _area.right(), _area.bottom());
 }
 
-void Bus::render() {
-  /* Original function
-  showBusStopDepartures(X_MARGIN, Y_MARGIN, _display.width() - X_MARGIN,
-                        _display.height() - Y_MARGIN); 
-                        */
+static_assert(MAX_STOPS + 1 <= MAX_APP_REGIONS,
+              "Not enough regions for the status bar and every stop");
 
-  //showBusStopDepartures(X_MARGIN, _display.height()/2 , _display.width() - X_MARGIN,
-  //                        _display.height() - Y_MARGIN); 
+/*
+ * Splits the board into the status bar and one region per stop, each with a
+ * digest of what render() would draw there. The time of the last update in the
+ * status bar is left out, it changes every cycle even when nothing else does.
+ * Instead the status bar is redrawn along with any stop that changes.
+ */
+size_t Bus::digestRegions(Rect regions[], uint32_t digests[]) {
+  const time_t now = time(NULL);
+  uint32_t statusHash = fnv1aHash(getWiFiDesc(wifiRSSI));
+  statusHash = fnv1aHash(&batPercent, sizeof(batPercent), statusHash);
+  statusHash = fnv1aHash(&isStale, sizeof(isStale), statusHash);
+
+  if (stops.empty()) {
+    // The next update time and the status bar fill the board's area, and the
+    // refresh icon and stale marker reach a little below it
+    char nextUpdateAtString[8];
+    strftime(nextUpdateAtString, sizeof(nextUpdateAtString), "%H:%M",
+             localtime(&nextUpdateTime));
+    regions[0] = {_area.x, _area.y, _area.w, (int16_t)(_area.h + 6)};
+    digests[0] = fnv1aHash(nextUpdateAtString, statusHash);
+    return 1;
+  }
 
-  
-  // Insert weather function here
-  // change y margin to the top of the bus box, change display height - ymargin to bottom of bus box
-  //showBusStopDepartures(_renderX, _renderY, _renderX + _renderWidth, _renderY + _renderHeight);
-  showBusStopDepartures(_renderX, _renderY, _renderWidth, _renderHeight);
+  size_t numRegions = 1;
+  for (size_t i = 0; i < stops.size(); i++) {
+    regions[numRegions] = getStopArea(i);
+    digests[numRegions] = digestStop(stops[i], now);
+    statusHash = fnv1aHash(&digests[numRegions], sizeof(uint32_t), statusHash);
+    numRegions++;
+  }
+  // The refresh icon and stale marker reach a little below the area
+  const int16_t b = _area.bottom();
+  regions[0] = {_area.x, (int16_t)(b - STATUS_BAR_HEIGHT - 4), _area.w,
+                STATUS_BAR_HEIGHT + 4 + 6};
+  digests[0] = statusHash;
+  return numRegions;
+}
+
+uint32_t Bus::digestStop(const stopDepartures &stop, time_t now) {
+  uint32_t hash = fnv1aHash(stop.description.name);
+  hash = fnv1aHash(stop.description.iconIds, stop.description.numIconIds, hash);
+  for (const Departure &departure : stop.departures) {
+    // Both the minutes countdown and the departure time are shown
+    int32_t minutes[] = {((int)difftime(departure.departureTime, now)) / 60,
+                         (int32_t)(departure.departureTime / 60)};
+    hash = fnv1aHash(departure.route, hash);
+    hash = fnv1aHash(departure.destination, hash);
+    hash = fnv1aHash(minutes, sizeof(minutes), hash);
+    hash = fnv1aHash(&departure.isRealtime, sizeof(departure.isRealtime),
+                     hash);
+  }
+  return hash;
+}
+
+/*
+ * Each stop gets an equal share of the area above the status bar.
+ */
+Rect Bus::getStopArea(size_t index) const {
+  int16_t heightPerStop =
+      (_area.h - STATUS_BAR_HEIGHT - 4) / (int16_t)stops.size();
+  return {_area.x, (int16_t)(_area.y + index * heightPerStop), _area.w,
+          heightPerStop};
 }
 
 void Bus::showBusStopDepartures(int16_t l, int16_t t, int16_t r, int16_t b) {
   const time_t now = time(NULL);
 
   // Show last updated time at the bottom
-  int16_t statusHeight =
-      _renderer.drawStatusBar(b, updateTime, wifiRSSI, batPercent);
-  // this works as an absolute reference, not relative. change how it works
+  _renderer.drawStatusBar(r, b, updateTime, wifiRSSI, batPercent);
+  if (isStale) {
+    _renderer.drawStaleMarker(l, b, LEFT);
+  }
 
-  int numStops = stopDocs.size();
-  if (stopDocs.size() == 0) {
+  if (stops.size() == 0) {
     char nextUpdateAtString[48];
     strftime(nextUpdateAtString, sizeof(nextUpdateAtString),
              "Next Update: %H:%M", localtime(&nextUpdateTime));
-    _renderer.drawError(epd_bitmap_sleep_schedule, nextUpdateAtString);
+    // In the board's own area, above the status bar
+    _renderer.drawError({_area.x, _area.y, _area.w,
+                         (int16_t)(_area.h - STATUS_BAR_HEIGHT - 4)},
+                        epd_bitmap_sleep_schedule, nextUpdateAtString);
     return;
   }
   
-  int16_t heightPerStop = (b - statusHeight - 4 - t) / numStops;
-  Serial.printf("Height for the train stops is: %lu pixels per stop and %lu in total", heightPerStop, heightPerStop * numStops);
-  Serial.printf("Y-Margin is: %lu pixels", Y_MARGIN);
-  Serial.printf("Display height is is: %lu pixels", _display.height()); 
-   int16_t y = t; // 
-  for (JsonDocument stopDoc : stopDocs) {
-    y = showDeparturesForStop(stopDoc, l, y, r, y + heightPerStop);
+  for (size_t i = 0; i < stops.size(); i++) {
+    Rect stopArea = getStopArea(i);
+    showDeparturesForStop(stops[i], l, stopArea.y, r, stopArea.bottom());
   }
 }
 
-int16_t Bus::showDeparturesForStop(JsonDocument &stopDoc, int16_t l, int16_t t,
-                                   int16_t r, int16_t b) {
+int16_t Bus::showDeparturesForStop(const stopDepartures &stop, int16_t l,
+                                   int16_t t, int16_t r, int16_t b) {
   int16_t y = t;
   int xMargin = 8;
 
   // Bus Stop Name
-  stopDescription stopDesc = getStopDescription(stopDoc);
+  const stopDescription &stopDesc = stop.description;
   _display.fillRoundRect(l, y, r - l, 36, 4, GxEPD_BLACK);
   int x = l + xMargin;
-  for (int iconId : stopDesc.iconIds) {
-    _display.drawInvertedBitmap(x, y + 2, getBitmapForIconId(iconId), 32, 32,
+  for (int i = 0; i < stopDesc.numIconIds; i++) {
+    _display.drawInvertedBitmap(x, y + 2,
+                                getBitmapForIconId(stopDesc.iconIds[i]), 32, 32,
                                 GxEPD_WHITE);
     x += 32 + 4;
   }
@@ -213,20 +355,11 @@ int16_t Bus::showDeparturesForStop(JsonDocument &stopDoc, int16_t l, int16_t t,
 
   // Departures
   int16_t stopEventHeight = 0;
-  std::vector<JsonObject> stopEvents =
-      getSortedStopEvents(stopDoc["stopEvents"]);
-  
-  const int maxDepartures = 4;  // Limit to 4 departures
-  int departuresShown = 0;
-  for (int i = 0; i < stopEvents.size() && departuresShown < maxDepartures; i++) {
-    JsonObject stopEvent = stopEvents[i];
-
+  for (const Departure &departure : stop.departures) {
     // Don't render if we are going to exceed the allocated height
     if (y + stopEventHeight > b - 8) {
       break;
     }
-    Serial.printf("y is %lu, stopeventheight is %lu, and b is %lu", y, stopEventHeight, b);
-    // why isn't this working ????????
 
     // If not the first entry, draw a divider line
     if (stopEventHeight) {
@@ -238,46 +371,13 @@ int16_t Bus::showDeparturesForStop(JsonDocument &stopDoc, int16_t l, int16_t t,
     }
 
     int16_t oldY = y;
-    y = drawStopEvent(stopEvent, l + xMargin, y, r - xMargin, b);
+    y = drawStopEvent(departure, l + xMargin, y, r - xMargin, b);
     stopEventHeight = y - oldY;
-
-    departuresShown++;
   }
   y += 8;
   return y;
 }
 
-stopDescription Bus::getStopDescription(JsonDocument &stopDoc) {
-  const char *fallbackStopName = stopDoc["locations"][0]["disassembledName"];
-  std::vector<int> iconIds;
-  JsonArray stopEvents = stopDoc["stopEvents"];
-  if (stopEvents.size() > 0) {
-    const char *stopName =
-        stopEvents[0]["location"]["parent"]["disassembledName"];
-    for (JsonObject stopEvent : stopEvents) {
-      const char *eventStopName =
-          stopEvent["location"]["parent"]["disassembledName"];
-      if (!stopName || !eventStopName || strcmp(stopName, eventStopName) != 0) {
-        stopName = fallbackStopName;
-      }
-      int eventIconId = stopEvent["transportation"]["product"]["iconId"];
-      if (std::find(iconIds.begin(), iconIds.end(), eventIconId) ==
-          iconIds.end()) {
-        iconIds.push_back(eventIconId);
-      }
-    }
-    std::sort(iconIds.begin(), iconIds.end());
-    return {stopName, iconIds};
-  } else {
-    JsonArray modes = stopDoc["locations"][0]["assignedStops"][0]["modes"];
-    for (int mode : modes) {
-      iconIds.push_back(mode);
-    }
-    std::sort(iconIds.begin(), iconIds.end());
-    return {fallbackStopName, iconIds};
-  }
-}
-
 const unsigned char *Bus::getBitmapForIconId(int16_t iconId) {
   switch (iconId) {
     case 1:
@@ -297,43 +397,16 @@ const unsigned char *Bus::getBitmapForIconId(int16_t iconId) {
   }
 }
 
-std::vector<JsonObject> Bus::getSortedStopEvents(
-    JsonArray stopEventsJsonArray) {
-  const time_t now = time(NULL);
-
-  std::vector<JsonObject> filteredStopEvents;
-  for (JsonObject stopEvent : stopEventsJsonArray) {
-    // Ignore cancelled departures
-    if (stopEvent["isCancelled"]) {
-      continue;
-    }
-
-    // Only show departures within the next hour
-    if (getDepartureTime(stopEvent) > now + 60 * 60) {
-      continue;
-    }
-
-    filteredStopEvents.push_back(stopEvent);
-  }
-
-  std::sort(filteredStopEvents.begin(), filteredStopEvents.end(),
-            [](const JsonObject &a, const JsonObject &b) {
-              return getDepartureTime(a) < getDepartureTime(b);
-            });
-  return filteredStopEvents;
-}
-
-int16_t Bus::drawStopEvent(const JsonObject &stopEvent, int16_t l, int16_t t,
+int16_t Bus::drawStopEvent(const Departure &departure, int16_t l, int16_t t,
                            int16_t r, int16_t b) {
   const time_t now = time(NULL);
   int16_t y = t;
 
-  bool isRealtime =
-      stopEvent["isRealtimeControlled"] && stopEvent["departureTimeEstimated"];
-  const char *busName = stopEvent["transportation"]["disassembledName"];
-  const char *destination = stopEvent["transportation"]["destination"]["name"];
+  bool isRealtime = departure.isRealtime;
+  const char *busName = departure.route;
+  const char *destination = departure.destination;
 
-  time_t departureTime_t = getDepartureTime(stopEvent);
+  time_t departureTime_t = departure.departureTime;
 
   char departureTimeHM[8];
   strftime(departureTimeHM, sizeof(departureTimeHM), "%H:%M",
@@ -349,22 +422,16 @@ int16_t Bus::drawStopEvent(const JsonObject &stopEvent, int16_t l, int16_t t,
   _display.setFont(&FreeSansBold24pt7b);
   y += 36;
 
-  int16_t bnbx, bnby;
-  uint16_t bnbw, bnbh;
-  _display.getTextBounds(busName, 0, 0, &bnbx, &bnby, &bnbw, &bnbh);
   _display.setCursor(l, y);
   _display.print(busName);
 
-  int16_t ndmbx, ndmby;
-  uint16_t ndmbw, ndmbh;
-  _display.getTextBounds(nextDepartureMinutesString, 0, 0, &ndmbx, &ndmby,
-                         &ndmbw, &ndmbh);
+  uint16_t ndmbw =
+      measureText(&FreeSansBold24pt7b, nextDepartureMinutesString).w;
 
+  // The same for every row, so only measured once
   const char *minString = "  min";
+  static const uint16_t mbw = measureText(&FreeSansBold9pt7b, minString).w;
   _display.setFont(&FreeSansBold9pt7b);
-  int16_t mbx, mby;
-  uint16_t mbw, mbh;
-  _display.getTextBounds(minString, 0, 0, &mbx, &mby, &mbw, &mbh);
 
   _display.setCursor(r - mbw, y);
   _display.print(minString);
@@ -377,15 +444,10 @@ int16_t Bus::drawStopEvent(const JsonObject &stopEvent, int16_t l, int16_t t,
   _display.setFont(&FreeSans9pt7b);
   y += 14;
 
-  int16_t dbx, dby;
-  uint16_t dbw, dbh;
-  _display.getTextBounds(destination, 0, 0, &dbx, &dby, &dbw, &dbh);
   _display.setCursor(l, y);
   _display.print(destination);
 
-  int16_t rtbx, rtby;
-  uint16_t rtbw, rtbh;
-  _display.getTextBounds(departureTimeHM, 0, 0, &rtbx, &rtby, &rtbw, &rtbh);
+  uint16_t rtbw = measureText(&FreeSans9pt7b, departureTimeHM).w;
   _display.setCursor(r - rtbw, y);
   _display.print(departureTimeHM);
 
@@ -398,18 +460,3 @@ int16_t Bus::drawStopEvent(const JsonObject &stopEvent, int16_t l, int16_t t,
 
   return y;
 }
-
-time_t Bus::getDepartureTime(const JsonObject &stopEvent) {
-  bool isRealtime =
-      stopEvent["isRealtimeControlled"] && stopEvent["departureTimeEstimated"];
-
-  const char *departureTimeString =
-      stopEvent[isRealtime ? "departureTimeEstimated" : "departureTimePlanned"];
-  return parseTimeUtc(departureTimeString);
-}
-
-time_t Bus::parseTimeUtc(const char *utcTimeString) {
-  struct tm tm = {0};
-  strptime(utcTimeString, "%Y-%m-%dT%H:%M:%SZ", &tm);
-  return mktime(&tm) - _timezone;
-}
\ No newline at end of file
@@ -58,6 +58,24 @@ const uint16_t REFRESH_SCHEDULE[24] = {0,   0,  0,  0,  0,  0,  60, 120,
                                        120, 60, 60, 60, 60, 60, 60, 60,
                                        60,  60, 60, 60, 60, 60, 0,  0};
 const uint32_t DEEP_SLEEP_THRESHOLD = 5 * 60;
+// The configured stops share one board, ordered by departure time, with a
+// service listed at more than one of them shown once. Set to false to give
+// each stop its own section, for up to MAX_STOPS stops.
+const bool MERGE_STOPS = true;
+// Conditions barely change within half an hour, so the weather is fetched
+// less often than the departures
+const uint32_t WEATHER_MAX_AGE = 30 * 60;
+// Apps are fetched concurrently, so this bounds the slowest of them. An app
+// that misses it shows its last good data, so the radio is never on for much
+// longer than this.
+const uint32_t FETCH_CYCLE_BUDGET = 8000;
+// Deep sleep ends any fetch still running, so one that missed the budget is
+// given this long after the refresh to finish and be saved for the next wake.
+const uint32_t LATE_FETCH_GRACE = 5000;
+// Boards without PSRAM only draw the whole frame at once if this much RAM is
+// still free, enough for a fetch that missed the budget to finish its TLS
+// handshake. Otherwise the frame is drawn page by page.
+const uint32_t FULL_FRAME_HEAP_RESERVE = 50000;
 
 // BATTERY
 // To protect the battery upon LOW_BATTERY_VOLTAGE, the display will cease to
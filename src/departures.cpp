@@ -0,0 +1,258 @@
+// Decoding of TfNSW departure_mon responses.
+
+#include "departures.h"
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+/*
+ * The filters: they contain "true" for each value we want to keep
+ */
+static JsonDocument buildLocationFilter() {
+  JsonDocument filter;
+  filter["disassembledName"] = true;
+  filter["assignedStops"][0]["modes"] = true;
+  return filter;
+}
+
+static JsonDocument buildStopEventFilter() {
+  JsonDocument filter;
+  filter["departureTimePlanned"] = true;
+  filter["departureTimeEstimated"] = true;
+  filter["isRealtimeControlled"] = true;
+  filter["isCancelled"] = true;
+  filter["location"]["parent"]["disassembledName"] = true;
+  filter["transportation"]["disassembledName"] = true;
+  filter["transportation"]["product"]["iconId"] = true;
+  filter["transportation"]["destination"]["name"] = true;
+  return filter;
+}
+
+static Departure toDeparture(JsonObjectConst stopEvent) {
+  Departure departure = {};
+  departure.isRealtime =
+      stopEvent["isRealtimeControlled"] && stopEvent["departureTimeEstimated"];
+  departure.isCancelled = stopEvent["isCancelled"];
+  departure.iconId = stopEvent["transportation"]["product"]["iconId"];
+  strlcpy(departure.route,
+          stopEvent["transportation"]["disassembledName"] | "",
+          sizeof(departure.route));
+  strlcpy(departure.destination,
+          stopEvent["transportation"]["destination"]["name"] | "",
+          sizeof(departure.destination));
+
+  const char *departureTimeString =
+      stopEvent[departure.isRealtime ? "departureTimeEstimated"
+                                     : "departureTimePlanned"] |
+      "";
+  departure.departureTime = parseTimeUtc(departureTimeString);
+  return departure;
+}
+
+/*
+ * Reads a departure_mon response from the stream one stop event at a time,
+ * decoding each into a Departure. Only one stop event is ever held as a
+ * JsonDocument, so memory use no longer scales with the size of the response.
+ *
+ * This relies on the API emitting "locations" before "stopEvents". Departures
+ * are kept if they would be shown at now.
+ *
+ * Returns true if the response was parsed successfully.
+ */
+bool parseDepartures(Stream &stream, stopDepartures &stop, time_t now) {
+  stopDescription &desc = stop.description;
+  desc.name[0] = '\0';
+  desc.numIconIds = 0;
+
+  // Built on first use, then shared by every stop and every cycle
+  static const JsonDocument locationFilter = buildLocationFilter();
+  static const JsonDocument stopEventFilter = buildStopEventFilter();
+
+  // Only the first location is of interest, it describes the stop itself
+  if (!stream.find("\"locations\"") || !stream.find("[")) {
+    Serial.println("Error parsing response! No locations");
+    return false;
+  }
+  JsonDocument locationDoc;
+  DeserializationError err = deserializeJson(
+      locationDoc, stream,
+      DeserializationOption::Filter(locationFilter.as<JsonVariantConst>()));
+  if (err) {
+    Serial.printf("Error parsing response! %s\n", err.c_str());
+    return false;
+  }
+  const char *fallbackStopName = locationDoc["disassembledName"] | "";
+  JsonArrayConst modes = locationDoc["assignedStops"][0]["modes"];
+
+  // A stop with no upcoming services may not have any stopEvents at all
+  size_t numStopEvents = 0;
+  bool sameStopName = true;
+  char eventStopName[STOP_NAME_LEN] = "";
+  if (stream.find("\"stopEvents\"") && stream.find("[")) {
+    while (stream.peek() == ' ' || stream.peek() == '\n' ||
+           stream.peek() == '\r' || stream.peek() == '\t') {
+      stream.read();
+    }
+    bool hasStopEvents = stream.peek() != ']';
+    while (hasStopEvents) {
+      JsonDocument stopEventDoc;
+      err = deserializeJson(stopEventDoc, stream,
+                            DeserializationOption::Filter(
+                                stopEventFilter.as<JsonVariantConst>()));
+      if (err) {
+        Serial.printf("Error parsing response! %s\n", err.c_str());
+        return false;
+      }
+      JsonObjectConst stopEvent = stopEventDoc.as<JsonObjectConst>();
+      Departure departure = toDeparture(stopEvent);
+      numStopEvents++;
+
+      // The stop is named after its parent only if every event agrees on it
+      const char *parentName =
+          stopEvent["location"]["parent"]["disassembledName"];
+      if (numStopEvents == 1 && parentName) {
+        strlcpy(eventStopName, parentName, sizeof(eventStopName));
+      } else if (!parentName || strcmp(eventStopName, parentName) != 0) {
+        sameStopName = false;
+      }
+      addIconId(desc, departure.iconId);
+
+      if (isDepartureShown(departure, now)) {
+        stop.departures.push(departure);
+      }
+
+      hasStopEvents = stream.findUntil(",", "]");
+    }
+  }
+
+  if (numStopEvents > 0 && sameStopName && eventStopName[0]) {
+    strlcpy(desc.name, eventStopName, sizeof(desc.name));
+  } else {
+    strlcpy(desc.name, fallbackStopName, sizeof(desc.name));
+  }
+  if (numStopEvents == 0) {
+    for (int mode : modes) {
+      addIconId(desc, mode);
+    }
+  }
+  return true;
+}
+
+/*
+ * Adds the icon to the stop's icons, keeping them sorted and unique.
+ */
+void addIconId(stopDescription &desc, int iconId) {
+  int i = 0;
+  while (i < desc.numIconIds && desc.iconIds[i] < iconId) {
+    i++;
+  }
+  if ((i < desc.numIconIds && desc.iconIds[i] == iconId) ||
+      desc.numIconIds == MAX_STOP_MODES) {
+    return;
+  }
+  memmove(&desc.iconIds[i + 1], &desc.iconIds[i], desc.numIconIds - i);
+  desc.iconIds[i] = iconId;
+  desc.numIconIds++;
+}
+
+bool isDepartureShown(const Departure &departure, time_t now) {
+  // Ignore cancelled departures
+  if (departure.isCancelled) {
+    return false;
+  }
+
+  // Only show departures within the next hour
+  return departure.departureTime <= now + 60 * 60;
+}
+
+/*
+ * Decodes a "YYYY-MM-DDTHH:MM:SSZ" timestamp into a unix epoch. The epoch is
+ * computed arithmetically, so no libc time, locale or TZ functions are
+ * involved and the result does not depend on the local DST rules.
+ *
+ * Returns 0 if the string is not in exactly that format.
+ */
+time_t parseTimeUtc(const char *utcTimeString) {
+  static const char format[] = "dddd-dd-ddTdd:dd:ddZ";
+  for (size_t i = 0; i < sizeof(format) - 1; i++) {
+    char c = utcTimeString[i];
+    if (format[i] == 'd' ? (c < '0' || c > '9') : c != format[i]) {
+      return 0;
+    }
+  }
+
+  const char *s = utcTimeString;
+  int32_t year = (s[0] - '0') * 1000 + (s[1] - '0') * 100 + (s[2] - '0') * 10 +
+                 (s[3] - '0');
+  int32_t month = (s[5] - '0') * 10 + (s[6] - '0');
+  int32_t day = (s[8] - '0') * 10 + (s[9] - '0');
+  int32_t hour = (s[11] - '0') * 10 + (s[12] - '0');
+  int32_t minute = (s[14] - '0') * 10 + (s[15] - '0');
+  int32_t second = (s[17] - '0') * 10 + (s[18] - '0');
+  if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 ||
+      minute > 59 || second > 60) {
+    return 0;
+  }
+
+  // Days since 1970-01-01 in the proleptic Gregorian calendar, counting years
+  // from March so the leap day falls at the end of the year.
+  // See http://howardhinnant.github.io/date_algorithms.html#days_from_civil
+  year -= month <= 2;
+  // Rounded down, as January and February of year 0 count as year -1
+  int32_t era = (year >= 0 ? year : year - 399) / 400;
+  int32_t yearOfEra = year - era * 400;
+  int32_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 +
+                      day - 1;
+  int32_t dayOfEra =
+      yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  int64_t days = (int64_t)era * 146097 + dayOfEra - 719468;
+
+  return (time_t)(days * 86400 + hour * 3600 + minute * 60 + second);
+}
+
+/*
+ * Merges the stop's departures into the board. Both lists are sorted, so this
+ * is a single pass over each, and the board stays bounded at MAX_DEPARTURES
+ * however many stops are merged into it. A service that is listed at more than
+ * one of the stops only appears once.
+ */
+void mergeDepartures(stopDepartures &board, const stopDepartures &stop) {
+  TopK<Departure, MAX_DEPARTURES, departureEarlier> merged;
+  const Departure *a = board.departures.begin();
+  const Departure *b = stop.departures.begin();
+  while (merged.size() < MAX_DEPARTURES &&
+         (a != board.departures.end() || b != stop.departures.end())) {
+    const Departure *next = b == stop.departures.end() ||
+                                    (a != board.departures.end() &&
+                                     a->departureTime <= b->departureTime)
+                                ? a++
+                                : b++;
+    bool isDuplicate = false;
+    for (const Departure &departure : merged) {
+      isDuplicate |= isSameService(departure, *next);
+    }
+    if (!isDuplicate) {
+      merged.push(*next);
+    }
+  }
+  board.departures = merged;
+
+  // The board is named after the first stop and shows every stop's modes
+  if (!board.description.name[0]) {
+    strlcpy(board.description.name, stop.description.name,
+            sizeof(board.description.name));
+  }
+  for (int i = 0; i < stop.description.numIconIds; i++) {
+    addIconId(board.description, stop.description.iconIds[i]);
+  }
+}
+
+/*
+ * Whether two departures are the same service seen from different stops.
+ */
+bool isSameService(const Departure &a, const Departure &b) {
+  time_t difference = a.departureTime - b.departureTime;
+  return strcmp(a.route, b.route) == 0 &&
+         strcmp(a.destination, b.destination) == 0 && difference < 60 &&
+         difference > -60;
+}
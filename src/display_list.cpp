@@ -0,0 +1,241 @@
+#include "display_list.h"
+
+#include <stdlib.h>
+
+DisplayList::DisplayList(int16_t w, int16_t h)
+    : Adafruit_GFX(w, h), _textEndX(0) {}
+
+/*
+ * Starts a new frame. The buffers keep their capacity, so a frame the size of
+ * the last one doesn't allocate.
+ */
+void DisplayList::clear() {
+  _ops.clear();
+  _text.clear();
+}
+
+/*
+ * Draws every recorded operation that reaches into clip onto target.
+ */
+void DisplayList::replay(GxEPD2_GFX &target, const Rect &clip) const {
+  replayOnto(target, clip);
+}
+
+void DisplayList::replay(FrameBuffer &target, const Rect &clip) const {
+  replayOnto(target, clip);
+}
+
+template <class Target>
+void DisplayList::replayOnto(Target &target, const Rect &clip) const {
+  for (const displayOp &op : _ops) {
+    if (!op.bounds.intersects(clip)) {
+      continue;
+    }
+    switch (op.type) {
+      case OP_FILL_RECT:
+        target.fillRect(op.bounds.x, op.bounds.y, op.bounds.w, op.bounds.h,
+                        op.color);
+        break;
+      case OP_LINE:
+        target.drawLine(op.x0, op.y0, op.x1, op.y1, op.color);
+        break;
+      case OP_BITMAP:
+        target.drawBitmap(op.x0, op.y0, (const uint8_t *)op.data, op.x1, op.y1,
+                          op.color);
+        break;
+      case OP_INVERTED_BITMAP:
+        target.drawInvertedBitmap(op.x0, op.y0, (const uint8_t *)op.data,
+                                  op.x1, op.y1, op.color);
+        break;
+      case OP_TEXT:
+        target.setFont((const GFXfont *)op.data);
+        target.setTextSize(op.textSize);
+        target.setTextColor(op.color);
+        target.setCursor(op.x0, op.y0);
+        target.write((const uint8_t *)&_text[op.x1], op.y1);
+        break;
+    }
+  }
+}
+
+void DisplayList::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  addRect(x, y, 1, 1, color);
+}
+
+void DisplayList::writePixel(int16_t x, int16_t y, uint16_t color) {
+  addRect(x, y, 1, 1, color);
+}
+
+void DisplayList::writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                                uint16_t color) {
+  addRect(x, y, w, h, color);
+}
+
+void DisplayList::writeFastVLine(int16_t x, int16_t y, int16_t h,
+                                 uint16_t color) {
+  addRect(x, y, 1, h, color);
+}
+
+void DisplayList::writeFastHLine(int16_t x, int16_t y, int16_t w,
+                                 uint16_t color) {
+  addRect(x, y, w, 1, color);
+}
+
+void DisplayList::writeLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                            uint16_t color) {
+  drawLine(x0, y0, x1, y1, color);
+}
+
+void DisplayList::drawFastVLine(int16_t x, int16_t y, int16_t h,
+                                uint16_t color) {
+  addRect(x, y, 1, h, color);
+}
+
+void DisplayList::drawFastHLine(int16_t x, int16_t y, int16_t w,
+                                uint16_t color) {
+  addRect(x, y, w, 1, color);
+}
+
+void DisplayList::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                           uint16_t color) {
+  addRect(x, y, w, h, color);
+}
+
+void DisplayList::fillScreen(uint16_t color) {
+  addRect(0, 0, width(), height(), color);
+}
+
+void DisplayList::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                           uint16_t color) {
+  if (y0 == y1) {
+    addRect(min(x0, x1), y0, abs(x1 - x0) + 1, 1, color);
+  } else if (x0 == x1) {
+    addRect(x0, min(y0, y1), 1, abs(y1 - y0) + 1, color);
+  } else {
+    displayOp op = {};
+    op.type = OP_LINE;
+    op.color = color;
+    op.bounds = {min(x0, x1), min(y0, y1), (int16_t)(abs(x1 - x0) + 1),
+                 (int16_t)(abs(y1 - y0) + 1)};
+    op.x0 = x0;
+    op.y0 = y0;
+    op.x1 = x1;
+    op.y1 = y1;
+    _ops.push_back(op);
+  }
+}
+
+void DisplayList::drawBitmap(int16_t x, int16_t y, const uint8_t bitmap[],
+                             int16_t w, int16_t h, uint16_t color) {
+  displayOp op = {};
+  op.type = OP_BITMAP;
+  op.color = color;
+  op.bounds = {x, y, w, h};
+  op.x0 = x;
+  op.y0 = y;
+  op.x1 = w;
+  op.y1 = h;
+  op.data = bitmap;
+  _ops.push_back(op);
+}
+
+void DisplayList::drawInvertedBitmap(int16_t x, int16_t y,
+                                     const uint8_t bitmap[], int16_t w,
+                                     int16_t h, uint16_t color) {
+  drawBitmap(x, y, bitmap, w, h, color);
+  _ops.back().type = OP_INVERTED_BITMAP;
+}
+
+/*
+ * Records the character and moves the cursor on the same way Adafruit_GFX
+ * would when drawing it.
+ */
+size_t DisplayList::write(uint8_t c) {
+  if (c == '\r') {
+    return 1;
+  }
+  if (!gfxFont) {
+    // Built in 6x8 font
+    if (c == '\n') {
+      cursor_x = 0;
+      cursor_y += textsize_y * 8;
+      return 1;
+    }
+    addChar(c, {cursor_x, cursor_y, (int16_t)(textsize_x * 6),
+                (int16_t)(textsize_y * 8)});
+    cursor_x += textsize_x * 6;
+    _textEndX = cursor_x;
+    return 1;
+  }
+
+  if (c == '\n') {
+    cursor_x = 0;
+    cursor_y += (int16_t)textsize_y * (uint8_t)gfxFont->yAdvance;
+    return 1;
+  }
+  if (c < gfxFont->first || c > gfxFont->last) {
+    return 1;
+  }
+  const GFXglyph &glyph = gfxFont->glyph[c - gfxFont->first];
+  addChar(c, {(int16_t)(cursor_x + glyph.xOffset * textsize_x),
+              (int16_t)(cursor_y + glyph.yOffset * textsize_y),
+              (int16_t)(glyph.width * textsize_x),
+              (int16_t)(glyph.height * textsize_y)});
+  cursor_x += glyph.xAdvance * (int16_t)textsize_x;
+  _textEndX = cursor_x;
+  return 1;
+}
+
+/*
+ * Adds a filled rectangle, merging it into the last one if it carries on along
+ * the same rows.
+ */
+void DisplayList::addRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                          uint16_t color) {
+  if (w <= 0 || h <= 0) {
+    return;
+  }
+  if (!_ops.empty()) {
+    displayOp &last = _ops.back();
+    if (last.type == OP_FILL_RECT && last.color == color &&
+        last.bounds.y == y && last.bounds.h == h && last.bounds.right() == x) {
+      last.bounds.w += w;
+      return;
+    }
+  }
+  displayOp op = {};
+  op.type = OP_FILL_RECT;
+  op.color = color;
+  op.bounds = {x, y, w, h};
+  _ops.push_back(op);
+}
+
+/*
+ * Adds a character at the cursor, appending it to the last text run if the
+ * run ends at the cursor and is drawn the same way.
+ */
+void DisplayList::addChar(uint8_t c, const Rect &glyphBounds) {
+  if (!_ops.empty()) {
+    displayOp &last = _ops.back();
+    if (last.type == OP_TEXT && last.data == gfxFont &&
+        last.color == textcolor && last.textSize == textsize_x &&
+        last.y0 == cursor_y && _textEndX == cursor_x) {
+      _text.push_back(c);
+      last.y1++;
+      last.bounds = last.bounds.unite(glyphBounds);
+      return;
+    }
+  }
+  displayOp op = {};
+  op.type = OP_TEXT;
+  op.textSize = textsize_x;
+  op.color = textcolor;
+  op.bounds = glyphBounds;
+  op.x0 = cursor_x;
+  op.y0 = cursor_y;
+  op.x1 = _text.size();
+  op.y1 = 1;
+  op.data = gfxFont;
+  _text.push_back(c);
+  _ops.push_back(op);
+}
@@ -34,3 +34,23 @@ const float getWifiFrac(int rssi) {
     return 0.4f;
   }
 }
+
+/*
+ * Returns the 32-bit FNV-1a hash of the data, continuing from hash so that
+ * several values can be combined into a single digest.
+ */
+uint32_t fnv1aHash(const void *data, size_t length, uint32_t hash) {
+  const uint8_t *bytes = (const uint8_t *)data;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+  return hash;
+}
+
+/*
+ * Returns the FNV-1a hash of the string, including its terminator so that
+ * consecutive strings can't run into each other.
+ */
+uint32_t fnv1aHash(const char *str, uint32_t hash) {
+  return fnv1aHash(str, strlen(str) + 1, hash);
+}
@@ -0,0 +1,204 @@
+// Concurrent app fetches.
+
+#include "fetch_executor.h"
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#else
+#include <chrono>
+#include <system_error>
+#include <thread>
+#endif
+
+FetchExecutor::FetchExecutor() : _tasks{} {
+  for (size_t i = 0; i < MAX_FETCH_TASKS; i++) {
+    _tasks[i].executor = this;
+    _tasks[i].index = i;
+  }
+#if defined(ARDUINO)
+  _done = NULL;
+#endif
+}
+
+/*
+ * Fetches all of the apps, returning once they have all finished or timeoutMs
+ * has passed. statuses[i] is set to the outcome for apps[i]. An app still
+ * fetching from an earlier run isn't started again and is reported as timed
+ * out, what it fetches is handed back by wait() as before.
+ */
+void FetchExecutor::run(IApp *const apps[], size_t numApps,
+                        uint32_t timeoutMs, fetchStatus_t statuses[]) {
+#if defined(ARDUINO)
+  if (_done == NULL) {
+    _done = xEventGroupCreate();
+  }
+#endif
+
+  fetchTask *tasks[MAX_FETCH_TASKS] = {};
+  uint32_t started = 0;
+  for (size_t i = 0; i < numApps && i < MAX_FETCH_TASKS; i++) {
+    fetchTask *task = taskFor(apps[i]);
+    if (task == NULL || task->running) {
+      continue;
+    }
+    tasks[i] = task;
+    task->result = false;
+    task->done = false;
+    task->running = true;
+#if defined(ARDUINO)
+    xEventGroupClearBits(_done, 1 << task->index);
+#endif
+    started |= 1 << task->index;
+    if (!start(*task)) {
+      // Not enough memory for another task, so fetch it here instead
+      finish(*task, task->app->fetchData());
+    }
+  }
+
+  uint32_t done = waitForTasks(started, timeoutMs);
+  for (size_t i = 0; i < numApps; i++) {
+    fetchTask *task = i < MAX_FETCH_TASKS ? tasks[i] : NULL;
+    if (task == NULL || !(done & (1 << task->index))) {
+      statuses[i] = FETCH_TIMED_OUT;
+    } else {
+      task->running = false;
+      statuses[i] = task->result ? FETCH_OK : FETCH_FAILED;
+    }
+  }
+}
+
+/*
+ * Waits up to timeoutMs for the apps left running by earlier runs. The ones
+ * that have since fetched successfully are put in lateApps, with the time each
+ * finished in finishTimes. Both must have room for MAX_FETCH_TASKS. Each is
+ * only handed back once, and apps still fetching are left running. Returns how
+ * many there are.
+ */
+size_t FetchExecutor::wait(uint32_t timeoutMs, IApp *lateApps[],
+                           time_t finishTimes[]) {
+  uint32_t running = 0;
+  for (size_t i = 0; i < MAX_FETCH_TASKS; i++) {
+    if (_tasks[i].running) {
+      running |= 1 << i;
+    }
+  }
+  uint32_t done = waitForTasks(running, timeoutMs);
+  size_t numLate = 0;
+  for (size_t i = 0; i < MAX_FETCH_TASKS; i++) {
+    if (!(done & (1 << i))) {
+      continue;
+    }
+    _tasks[i].running = false;
+    if (_tasks[i].result) {
+      lateApps[numLate] = _tasks[i].app;
+      finishTimes[numLate++] = _tasks[i].finishTime;
+    }
+  }
+  return numLate;
+}
+
+/*
+ * Returns how many apps are still fetching, as of the last run() or wait().
+ */
+size_t FetchExecutor::numRunning() const {
+  size_t numRunning = 0;
+  for (size_t i = 0; i < MAX_FETCH_TASKS; i++) {
+    numRunning += _tasks[i].running;
+  }
+  return numRunning;
+}
+
+/*
+ * The app's slot, claiming a free one the first time it is run. Returns NULL
+ * if every slot belongs to another app.
+ */
+FetchExecutor::fetchTask *FetchExecutor::taskFor(IApp *app) {
+  for (size_t i = 0; i < MAX_FETCH_TASKS; i++) {
+    if (_tasks[i].app == app) {
+      return &_tasks[i];
+    }
+  }
+  for (size_t i = 0; i < MAX_FETCH_TASKS; i++) {
+    if (_tasks[i].app == NULL) {
+      _tasks[i].app = app;
+      return &_tasks[i];
+    }
+  }
+  return NULL;
+}
+
+#if defined(ARDUINO)
+
+bool FetchExecutor::start(fetchTask &task) {
+  return xTaskCreatePinnedToCore(taskMain, "fetch", FETCH_TASK_STACK_SIZE,
+                                 &task, 1, NULL,
+                                 task.index % portNUM_PROCESSORS) == pdPASS;
+}
+
+void FetchExecutor::taskMain(void *param) {
+  fetchTask &task = *(fetchTask *)param;
+  task.executor->finish(task, task.app->fetchData());
+  vTaskDelete(NULL);
+}
+
+void FetchExecutor::finish(fetchTask &task, bool result) {
+  task.result = result;
+  task.finishTime = time(NULL);
+  task.done = true;
+  xEventGroupSetBits(_done, 1 << task.index);
+}
+
+/*
+ * Waits up to timeoutMs for all of the tasks in mask, returning a mask of the
+ * ones that have finished.
+ */
+uint32_t FetchExecutor::waitForTasks(uint32_t mask, uint32_t timeoutMs) {
+  if (mask == 0) {
+    return 0;
+  }
+  return xEventGroupWaitBits(_done, mask, pdFALSE, pdTRUE,
+                             pdMS_TO_TICKS(timeoutMs)) &
+         mask;
+}
+
+#else
+
+bool FetchExecutor::start(fetchTask &task) {
+  try {
+    std::thread([this, &task]() { finish(task, task.app->fetchData()); })
+        .detach();
+    return true;
+  } catch (const std::system_error &) {
+    return false;
+  }
+}
+
+void FetchExecutor::finish(fetchTask &task, bool result) {
+  std::lock_guard<std::mutex> guard(_lock);
+  task.result = result;
+  task.finishTime = time(NULL);
+  task.done = true;
+  _changed.notify_all();
+}
+
+/*
+ * Waits up to timeoutMs for all of the tasks in mask, returning a mask of the
+ * ones that have finished.
+ */
+uint32_t FetchExecutor::waitForTasks(uint32_t mask, uint32_t timeoutMs) {
+  std::unique_lock<std::mutex> guard(_lock);
+  auto finished = [this, mask]() {
+    uint32_t done = 0;
+    for (size_t i = 0; i < MAX_FETCH_TASKS; i++) {
+      if ((mask & (1 << i)) && _tasks[i].done) {
+        done |= 1 << i;
+      }
+    }
+    return done;
+  };
+  _changed.wait_for(guard, std::chrono::milliseconds(timeoutMs),
+                    [&]() { return finished() == mask; });
+  return finished();
+}
+
+#endif
@@ -0,0 +1,78 @@
+// Keep-alive HTTPS requests for the departure board.
+
+#include "fetch_session.h"
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+
+FetchSession::FetchSession()
+    : _body(_client), _numRequests(0), _totalLatency(0) {
+  // No CA certificate is pinned, as was the case for the per-request clients
+  _client.setInsecure();
+  _http.setReuse(true);
+  _body.setTimeout(HTTPCLIENT_DEFAULT_TCP_TIMEOUT);
+}
+
+FetchSession::~FetchSession() { close(); }
+
+/*
+ * Sends a GET request, reusing the open connection if there is one. The
+ * response body is then available from getStream() until end() is called.
+ *
+ * Returns the HTTP status code, or a negative HTTPC_ERROR_* code.
+ */
+int FetchSession::get(const char *url, const char *authType,
+                      const char *auth) {
+  uint32_t start = millis();
+  bool reused = _client.connected();
+
+  // HTTP/1.1, as HTTPClient closes HTTP/1.0 connections after each response
+  _http.useHTTP10(false);
+  _http.begin(_client, url);
+  static const char *headerKeys[] = {"Transfer-Encoding"};
+  _http.collectHeaders(headerKeys, sizeof(headerKeys) / sizeof(headerKeys[0]));
+  if (authType) {
+    _http.setAuthorizationType(authType);
+  }
+  if (auth) {
+    _http.setAuthorization(auth);
+  }
+
+  int httpCode = _http.GET();
+  if (httpCode > 0) {
+    _body.reset(_http.getSize(),
+                _http.header("Transfer-Encoding").equalsIgnoreCase("chunked"));
+  }
+
+  uint32_t latency = millis() - start;
+  _numRequests++;
+  _totalLatency += latency;
+  Serial.printf("Request %u finished in %lu millis (%s connection).\n",
+                _numRequests, latency, reused ? "reused" : "new");
+  return httpCode;
+}
+
+/*
+ * Finishes the current request. The connection is kept open for the next
+ * request only if the rest of the body could be read.
+ */
+void FetchSession::end(bool reuse) {
+  if (!reuse || !_body.drain()) {
+    _client.stop();
+  }
+  _http.end();
+}
+
+void FetchSession::close() {
+  if (_numRequests == 0) {
+    return;
+  }
+  _http.end();
+  _client.stop();
+  Serial.printf("Closed session after %u requests, average latency %lu "
+                "millis.\n",
+                _numRequests, _totalLatency / _numRequests);
+  _numRequests = 0;
+  _totalLatency = 0;
+}
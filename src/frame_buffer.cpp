@@ -0,0 +1,269 @@
+#include "frame_buffer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(ARDUINO)
+#include <esp_heap_caps.h>
+#endif
+
+FrameBuffer::FrameBuffer(int16_t w, int16_t h)
+    : Adafruit_GFX(w, h), _buffer(NULL), _inPsram(false) {
+  // As the display is set up, so replayed text runs off the edge the same way
+  setTextWrap(false);
+}
+
+FrameBuffer::~FrameBuffer() { release(); }
+
+/*
+ * Allocates the buffer in PSRAM if the board has it, otherwise in internal RAM
+ * as long as heapReserve bytes would still be free afterwards. Returns false
+ * if there isn't room, so the caller can fall back to drawing page by page.
+ */
+bool FrameBuffer::allocate(size_t heapReserve) {
+  if (_buffer != NULL) {
+    return true;
+  }
+  size_t size = bufferSize();
+#if defined(ARDUINO)
+  _buffer = (uint8_t *)heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+  _inPsram = _buffer != NULL;
+  if (_buffer == NULL &&
+      heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT) >=
+          size + heapReserve) {
+    _buffer = (uint8_t *)heap_caps_malloc(
+        size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  }
+#else
+  (void)heapReserve;
+  _buffer = (uint8_t *)malloc(size);
+#endif
+  return _buffer != NULL;
+}
+
+void FrameBuffer::release() {
+  free(_buffer);
+  _buffer = NULL;
+  _inPsram = false;
+}
+
+void FrameBuffer::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  if (x < 0 || x >= width() || y < 0 || y >= height()) {
+    return;
+  }
+  // Back to the coordinates of the unrotated panel
+  int16_t t;
+  switch (getRotation()) {
+    case 1:
+      t = x;
+      x = WIDTH - 1 - y;
+      y = t;
+      break;
+    case 2:
+      x = WIDTH - 1 - x;
+      y = HEIGHT - 1 - y;
+      break;
+    case 3:
+      t = x;
+      x = y;
+      y = HEIGHT - 1 - t;
+      break;
+  }
+  uint8_t &byte = _buffer[(size_t)y * ((WIDTH + 7) / 8) + x / 8];
+  uint8_t bit = 0x80 >> (x & 7);
+  if (color) {
+    byte |= bit;
+  } else {
+    byte &= ~bit;
+  }
+}
+
+void FrameBuffer::fillScreen(uint16_t color) {
+  memset(_buffer, color ? 0xFF : 0x00, bufferSize());
+}
+
+void FrameBuffer::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                           uint16_t color) {
+  Rect area = Rect{x, y, w, h}.intersect({0, 0, width(), height()});
+  if (area.empty()) {
+    return;
+  }
+  Rect panel = toPanel(area);
+  for (int16_t row = panel.y; row < panel.bottom(); row++) {
+    fillSpan(row, panel.x, panel.w, color);
+  }
+}
+
+void FrameBuffer::writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                                uint16_t color) {
+  fillRect(x, y, w, h, color);
+}
+
+void FrameBuffer::drawFastVLine(int16_t x, int16_t y, int16_t h,
+                                uint16_t color) {
+  fillRect(x, y, 1, h, color);
+}
+
+void FrameBuffer::drawFastHLine(int16_t x, int16_t y, int16_t w,
+                                uint16_t color) {
+  fillRect(x, y, w, 1, color);
+}
+
+void FrameBuffer::writeFastVLine(int16_t x, int16_t y, int16_t h,
+                                 uint16_t color) {
+  fillRect(x, y, 1, h, color);
+}
+
+void FrameBuffer::writeFastHLine(int16_t x, int16_t y, int16_t w,
+                                 uint16_t color) {
+  fillRect(x, y, w, 1, color);
+}
+
+void FrameBuffer::drawBitmap(int16_t x, int16_t y, const uint8_t bitmap[],
+                             int16_t w, int16_t h, uint16_t color) {
+  blit(x, y, bitmap, w, h, color, false);
+}
+
+void FrameBuffer::drawInvertedBitmap(int16_t x, int16_t y,
+                                     const uint8_t bitmap[], int16_t w,
+                                     int16_t h, uint16_t color) {
+  blit(x, y, bitmap, w, h, color, true);
+}
+
+/*
+ * Transposes an 8x8 block of pixels, a byte per row with the leftmost pixel
+ * in the top bit, so that rows become columns.
+ */
+static void transpose8(const uint8_t in[8], uint8_t out[8]) {
+  uint64_t bits = 0;
+  for (int i = 0; i < 8; i++) {
+    bits = (bits << 8) | in[i];
+  }
+  uint64_t t;
+  t = (bits ^ (bits >> 7)) & 0x00AA00AA00AA00AAULL;
+  bits ^= t ^ (t << 7);
+  t = (bits ^ (bits >> 14)) & 0x0000CCCC0000CCCCULL;
+  bits ^= t ^ (t << 14);
+  t = (bits ^ (bits >> 28)) & 0x00000000F0F0F0F0ULL;
+  bits ^= t ^ (t << 28);
+  for (int i = 7; i >= 0; i--) {
+    out[i] = bits;
+    bits >>= 8;
+  }
+}
+
+/*
+ * Draws the set bits of the bitmap, or the clear ones if inverted, a byte of
+ * the bitmap at a time. In rotation 3 each row of the bitmap is a column of
+ * the panel, so the bitmap is turned 8x8 pixels at a time.
+ */
+void FrameBuffer::blit(int16_t x, int16_t y, const uint8_t bitmap[],
+                       int16_t w, int16_t h, uint16_t color, bool inverted) {
+  const int16_t byteWidth = (w + 7) / 8;
+  // Bits of the last byte of each row that are inside the bitmap
+  const uint8_t lastMask = (w & 7) ? 0xFF << (8 - (w & 7)) : 0xFF;
+  const uint8_t flip = inverted ? 0xFF : 0x00;
+  const bool inside = x >= 0 && y >= 0 && x + w <= width() &&
+                      y + h <= height();
+  const uint8_t rotation = getRotation();
+
+  if (inside && rotation == 0) {
+    for (int16_t j = 0; j < h; j++) {
+      const uint8_t *row = bitmap + j * byteWidth;
+      for (int16_t b = 0; b < byteWidth; b++) {
+        uint8_t bits = row[b] ^ flip;
+        if (b == byteWidth - 1) {
+          bits &= lastMask;
+        }
+        writeBits(y + j, x + 8 * b, bits, color);
+      }
+    }
+    return;
+  }
+
+  if (inside && rotation == 3) {
+    // Bitmap pixel i,j is panel pixel y + j, HEIGHT - 1 - (x + i)
+    for (int16_t j0 = 0; j0 < h; j0 += 8) {
+      for (int16_t b = 0; b < byteWidth; b++) {
+        uint8_t block[8];
+        for (int16_t r = 0; r < 8; r++) {
+          block[r] = j0 + r < h ? bitmap[(j0 + r) * byteWidth + b] ^ flip : 0;
+          if (b == byteWidth - 1) {
+            block[r] &= lastMask;
+          }
+        }
+        uint8_t columns[8];
+        transpose8(block, columns);
+        for (int16_t k = 0; k < 8 && 8 * b + k < w; k++) {
+          writeBits(HEIGHT - 1 - (x + 8 * b + k), y + j0, columns[k], color);
+        }
+      }
+    }
+    return;
+  }
+
+  for (int16_t j = 0; j < h; j++) {
+    const uint8_t *row = bitmap + j * byteWidth;
+    for (int16_t i = 0; i < w; i++) {
+      if ((row[i / 8] ^ flip) & (0x80 >> (i & 7))) {
+        drawPixel(x + i, y + j, color);
+      }
+    }
+  }
+}
+
+/*
+ * Fills w pixels of a row of the panel from x, which must all be inside it.
+ */
+void FrameBuffer::fillSpan(int16_t row, int16_t x, int16_t w, uint16_t color) {
+  uint8_t *line = _buffer + (size_t)row * ((WIDTH + 7) / 8);
+  int16_t first = x / 8;
+  int16_t last = (x + w - 1) / 8;
+  uint8_t firstMask = 0xFF >> (x & 7);
+  uint8_t lastMask = 0xFF << (7 - ((x + w - 1) & 7));
+  if (first == last) {
+    firstMask &= lastMask;
+  }
+  line[first] = color ? line[first] | firstMask : line[first] & ~firstMask;
+  if (first == last) {
+    return;
+  }
+  memset(line + first + 1, color ? 0xFF : 0x00, last - first - 1);
+  line[last] = color ? line[last] | lastMask : line[last] & ~lastMask;
+}
+
+/*
+ * Sets the pixels of a row of the panel from x whose bits are set, the top bit
+ * being x. The set bits must be inside the panel.
+ */
+void FrameBuffer::writeBits(int16_t row, int16_t x, uint8_t bits,
+                            uint16_t color) {
+  if (bits == 0) {
+    return;
+  }
+  uint8_t *line = _buffer + (size_t)row * ((WIDTH + 7) / 8);
+  uint8_t shift = x & 7;
+  uint8_t high = bits >> shift;
+  uint8_t low = bits << (8 - shift);
+  uint8_t *dest = line + x / 8;
+  dest[0] = color ? dest[0] | high : dest[0] & ~high;
+  if (shift != 0 && low != 0) {
+    dest[1] = color ? dest[1] | low : dest[1] & ~low;
+  }
+}
+
+/*
+ * Converts an area in rotated coordinates to the unrotated panel's.
+ */
+Rect FrameBuffer::toPanel(const Rect &area) const {
+  switch (getRotation()) {
+    case 1:
+      return {(int16_t)(WIDTH - area.y - area.h), area.x, area.h, area.w};
+    case 2:
+      return {(int16_t)(WIDTH - area.x - area.w),
+              (int16_t)(HEIGHT - area.y - area.h), area.w, area.h};
+    case 3:
+      return {area.y, (int16_t)(HEIGHT - area.x - area.w), area.h, area.w};
+  }
+  return area;
+}
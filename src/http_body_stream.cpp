@@ -0,0 +1,183 @@
+// HTTP/1.1 response bodies read from a connection that stays open.
+
+#include "http_body_stream.h"
+
+#include <Arduino.h>
+
+HttpBodyStream::HttpBodyStream(Client &upstream)
+    : _upstream(upstream),
+      _chunked(false),
+      _finished(true),
+      _firstChunk(true),
+      _broken(false),
+      _remaining(0) {}
+
+/*
+ * Prepares the stream for the next response. contentLength is -1 when the
+ * server did not send one.
+ */
+void HttpBodyStream::reset(int contentLength, bool chunked) {
+  _chunked = chunked;
+  _firstChunk = true;
+  _broken = false;
+  _remaining = chunked ? 0 : contentLength;
+  _finished = !chunked && contentLength == 0;
+}
+
+/*
+ * Reads whatever is left of the body, so the next response starts at the
+ * right place in the connection.
+ *
+ * Returns false if the end of the body could not be found, in which case the
+ * connection must not be reused.
+ */
+bool HttpBodyStream::drain() {
+  if (!_chunked && _remaining < 0) {
+    // Without a length only closing the connection ends the body
+    return false;
+  }
+  while (!_finished) {
+    if (_chunked && _remaining == 0) {
+      // Waits for the framing itself, and finishes the body at the last
+      // chunk. Through timedRead() the -1 that follows would be retried until
+      // the timeout.
+      nextChunk();
+    } else if (timedRead() < 0) {
+      // Only waited for while data is still expected
+      return false;
+    }
+  }
+  return !_broken;
+}
+
+int HttpBodyStream::available() {
+  if (_finished || _remaining == 0) {
+    // Never report chunk framing as data
+    return 0;
+  }
+  int upstreamAvailable = _upstream.available();
+  if (_remaining > 0 && upstreamAvailable > _remaining) {
+    return _remaining;
+  }
+  return upstreamAvailable;
+}
+
+int HttpBodyStream::read() {
+  if (_finished || (_chunked && _remaining == 0 && !nextChunk()) ||
+      _finished) {
+    return -1;
+  }
+  int c = _upstream.read();
+  if (c >= 0 && _remaining > 0) {
+    _remaining--;
+    if (_remaining == 0 && !_chunked) {
+      _finished = true;
+    }
+  }
+  return c;
+}
+
+/*
+ * Waits for data as read() does, but takes whatever of the body has already
+ * arrived with one read of the connection instead of a read per byte.
+ */
+size_t HttpBodyStream::readBytes(char *buffer, size_t length) {
+  size_t count = 0;
+  while (count < length && !_finished) {
+    if (_chunked && _remaining == 0 && !nextChunk()) {
+      break;
+    }
+    size_t arrived = available();
+    if (arrived == 0) {
+      int c = timedRead();
+      if (c < 0) {
+        break;
+      }
+      buffer[count++] = (char)c;
+      continue;
+    }
+    if (arrived > length - count) {
+      arrived = length - count;
+    }
+    int n = _upstream.read((uint8_t *)buffer + count, arrived);
+    if (n <= 0) {
+      break;
+    }
+    count += n;
+    if (_remaining > 0) {
+      _remaining -= n;
+      if (_remaining == 0 && !_chunked) {
+        _finished = true;
+      }
+    }
+  }
+  return count;
+}
+
+int HttpBodyStream::peek() {
+  if (_finished || (_chunked && _remaining == 0 && !nextChunk()) ||
+      _finished) {
+    return -1;
+  }
+  return _upstream.peek();
+}
+
+/*
+ * Consumes the framing in front of the next chunk of a chunked body and sets
+ * up _remaining for its data. The zero length chunk (and any trailer) marks
+ * the end of the body.
+ */
+bool HttpBodyStream::nextChunk() {
+  // Every chunk's data is terminated by CRLF
+  if (!_firstChunk && (upstreamRead() != '\r' || upstreamRead() != '\n')) {
+    _broken = _finished = true;
+    return false;
+  }
+  _firstChunk = false;
+
+  int32_t size = 0;
+  int numDigits = 0;
+  int c;
+  bool inExtension = false;
+  while ((c = upstreamRead()) >= 0 && c != '\r') {
+    if (c == ';') {
+      inExtension = true;
+    } else if (inExtension) {
+      continue;
+    } else if (c >= '0' && c <= '9') {
+      size = size * 16 + (c - '0');
+      numDigits++;
+    } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+      size = size * 16 + ((c | 0x20) - 'a' + 10);
+      numDigits++;
+    } else {
+      break;
+    }
+  }
+  if (c != '\r' || upstreamRead() != '\n' || numDigits == 0 ||
+      numDigits > 7) {
+    _broken = _finished = true;
+    return false;
+  }
+
+  if (size == 0) {
+    // Skip any trailer fields, the body ends with an empty line
+    int lineLength;
+    do {
+      lineLength = 0;
+      while ((c = upstreamRead()) >= 0 && c != '\n') {
+        lineLength += c != '\r';
+      }
+    } while (c >= 0 && lineLength > 0);
+    _broken = c < 0;
+    _finished = true;
+    return false;
+  }
+  _remaining = size;
+  return true;
+}
+
+int HttpBodyStream::upstreamRead() {
+  uint8_t c;
+  return _upstream.readBytes(&c, 1) == 1 ? c : -1;
+}
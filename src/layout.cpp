@@ -0,0 +1,80 @@
+#include "layout.h"
+
+/*
+ * Returns the smallest rectangle covering both, ignoring empty ones.
+ */
+Rect Rect::unite(const Rect &other) const {
+  if (other.empty()) {
+    return *this;
+  }
+  if (empty()) {
+    return other;
+  }
+  int16_t left = x < other.x ? x : other.x;
+  int16_t top = y < other.y ? y : other.y;
+  int16_t r = right() > other.right() ? right() : other.right();
+  int16_t b = bottom() > other.bottom() ? bottom() : other.bottom();
+  return {left, top, (int16_t)(r - left), (int16_t)(b - top)};
+}
+
+/*
+ * Returns the part of this rectangle inside other, or an empty rectangle if
+ * they don't overlap.
+ */
+Rect Rect::intersect(const Rect &other) const {
+  if (!intersects(other)) {
+    return {0, 0, 0, 0};
+  }
+  int16_t left = x > other.x ? x : other.x;
+  int16_t top = y > other.y ? y : other.y;
+  int16_t r = right() < other.right() ? right() : other.right();
+  int16_t b = bottom() < other.bottom() ? bottom() : other.bottom();
+  return {left, top, (int16_t)(r - left), (int16_t)(b - top)};
+}
+
+/*
+ * Returns the rectangle grown outwards until all of its edges are multiples
+ * of n.
+ */
+Rect Rect::alignedTo(int16_t n) const {
+  int16_t left = x - ((x % n) + n) % n;
+  int16_t top = y - ((y % n) + n) % n;
+  int16_t r = right() + (n - ((right() % n) + n) % n) % n;
+  int16_t b = bottom() + (n - ((bottom() % n) + n) % n) % n;
+  return {left, top, (int16_t)(r - left), (int16_t)(b - top)};
+}
+
+/*
+ * Splits area from top to bottom into the regions, writing the rectangle for
+ * regions[i] into resolved[i]. If the minimum heights don't fit, the regions
+ * get their minimum heights and the last ones are cut off at the bottom of
+ * the area.
+ */
+void resolveLayout(const Rect &area, const layoutRegion regions[],
+                   size_t numRegions, Rect resolved[]) {
+  int32_t spare = area.h;
+  int32_t totalWeight = 0;
+  for (size_t i = 0; i < numRegions; i++) {
+    spare -= regions[i].minHeight;
+    totalWeight += regions[i].weight;
+  }
+  if (spare < 0) {
+    spare = 0;
+  }
+
+  // Shared out cumulatively, so rounding never leaves a gap at the bottom
+  int32_t weightSoFar = 0;
+  int16_t y = area.y;
+  int32_t minHeightSoFar = 0;
+  for (size_t i = 0; i < numRegions; i++) {
+    weightSoFar += regions[i].weight;
+    minHeightSoFar += regions[i].minHeight;
+    int32_t bottom = area.y + minHeightSoFar +
+                     (totalWeight > 0 ? spare * weightSoFar / totalWeight : 0);
+    if (bottom > area.bottom()) {
+      bottom = area.bottom();
+    }
+    resolved[i] = {area.x, y, area.w, (int16_t)(bottom > y ? bottom - y : 0)};
+    y = bottom > y ? bottom : y;
+  }
+}
@@ -21,15 +21,27 @@
 #include "bus.h"
 #include "client_utils.h"
 #include "config.h"
+#include "display_list.h"
+#include "fetch_executor.h"
+#include "frame_buffer.h"
 #include "icons.h"
+#include "layout.h"
 #include "renderer.h"
+#include "rtc_memory.h"
 #include "secrets.h"
 #include "weather.h"
 #include "weather_icons.h"
 
+// Rows of the panel drawn per page when there isn't room for the whole frame.
+// Boards that always have the room, such as those with PSRAM, can build with
+// a smaller page to save RAM.
+#ifndef DISPLAY_PAGE_HEIGHT
+#define DISPLAY_PAGE_HEIGHT (GxEPD2_750_T7::HEIGHT / 2)
+#endif
+
 // copy the constructor from GxEPD2display_selection.h of GxEPD_Example to here
 // and adapt it to the ESP32 Driver wiring, e.g.
-GxEPD2_BW<GxEPD2_750_T7, GxEPD2_750_T7::HEIGHT / 2> display(
+GxEPD2_BW<GxEPD2_750_T7, DISPLAY_PAGE_HEIGHT> display(
     GxEPD2_750_T7(PIN_EPD_CS, PIN_EPD_DC, PIN_EPD_RST,
                   PIN_EPD_BUSY));  // GDEW075T7 800x480, EK79655 (GD7965)
 
@@ -37,27 +49,78 @@ GxEPD2_BW<GxEPD2_750_T7, GxEPD2_750_T7::HEIGHT / 2> display(
 SPIClass hspi(HSPI);
 #endif
 
-Renderer renderer(display);
-Bus bus(display, renderer);
-Weather weather(display, renderer);
-IApp* apps[] = {&bus, &weather};
+// The apps draw each frame into this once, and it is replayed onto each page.
+// It is the size of the panel turned a quarter for portrait.
+DisplayList displayList(GxEPD2_750_T7::HEIGHT, GxEPD2_750_T7::WIDTH);
+Renderer renderer(displayList);
+Bus bus(displayList, renderer);
+Weather weather(displayList, renderer);
+// The whole frame, when there is room to draw it in one pass
+FrameBuffer frameBuffer(GxEPD2_750_T7::WIDTH, GxEPD2_750_T7::HEIGHT);
+// Apps from the top of the screen to the bottom
+IApp* apps[] = {&weather, &bus};
 const int numApps = sizeof(apps) / sizeof(apps[0]); //do i even need this?
+// Where each app in apps[] is drawn: its share of the panel inside the margin
+// for the ikea frame, after every app has its minimum height
+const layoutRegion appRegions[] = {
+    {1, 280},  // weather
+    {1, 280},  // bus
+};
+static_assert(sizeof(appRegions) / sizeof(appRegions[0]) == numApps,
+              "Every app needs a layout region");
+static_assert(numApps <= MAX_FETCH_TASKS, "Too many apps to fetch at once");
+FetchExecutor fetchExecutor;
 
-void initDisplay();
+Rect initDisplay(const Rect& window, bool& fullRefresh);
+void startFrame();
+void refreshDisplay(const Rect& window = {0, 0, 0, 0});
+void writeFrame(const Rect& area, bool fullRefresh);
+void layoutApps();
+Rect findDirtyArea();
+void logHeapUsage();
 void sleep(bool forceDeepSleep = false);
+size_t commitLateFetches(uint32_t timeoutMs);
+bool isDue(int app, time_t now);
+bool goOnline();
 void powerOffDisplay();
 
 void handleFatalError(const uint8_t* bitmap_196x196, const String& errMsgLn1,
                       const String& errMsgLn2 = "");
 
 bool displayInitialized = false;
+bool wifiStarted = false;
+bool timeSynchronized = false;
 uint32_t lastTimeSync = 0;
 int partialRefreshCount = 0;
 
+// The regions an app drew in the last refresh, with a digest of each
+struct appDigests {
+  uint8_t numRegions;
+  Rect regions[MAX_APP_REGIONS];
+  uint32_t digests[MAX_APP_REGIONS];
+};
+
+// What each app drew in the last refresh, kept across deep sleep
+RTC_DATA_ATTR appDigests lastDigests[numApps] = {};
+RTC_DATA_ATTR uint32_t skippedRefreshCount = 0;
+// When each app was last fetched successfully, 0 if never
+RTC_DATA_ATTR time_t lastFetched[numApps] = {0};
+static_assert(sizeof(lastDigests) + sizeof(skippedRefreshCount) +
+                      sizeof(lastFetched) <=
+                  RTC_MAIN_SHARE,
+              "more apps than RTC_MAIN_SHARE has room for");
+
+// Wakes drift by a few seconds, so data this close to its max age is treated
+// as due rather than left to go a whole refresh interval over
+const uint32_t FETCH_AGE_SLACK = 60;  // seconds
+
 void setup() {
   Serial.begin(115200);
   Serial.println("setup");
 
+  // The layout is fixed, so it is worked out once per wake
+  layoutApps();
+
   // Not sure this does anything but copied from
   // https://github.com/espressif/esp-idf/tree/master/examples/wifi/power_save
   esp_pm_config_esp32_t pm_config = {
@@ -66,23 +129,11 @@ void setup() {
       .light_sleep_enable = true};
   esp_pm_configure(&pm_config);
 
-  // WIFI
-  wl_status_t wifiStatus = startWiFi();
-  if (wifiStatus != WL_CONNECTED) {  // WiFi Connection Failed
-    handleFatalError(epd_bitmap_wifi_off, wifiStatus == WL_NO_SSID_AVAIL
-                                              ? "Network Not Available"
-                                              : "Wifi Connection Failed");
-    return;
-  }
-
-  // TIME SYNCHRONIZATION
-  configTzTime(TIMEZONE, NTP_SERVER_1, NTP_SERVER_2);
-  bool timeConfigured = waitForSNTPSync();
-  if (!timeConfigured) {
-    handleFatalError(epd_bitmap_wifi_off, "Time Synchronization Failed");
-    return;
-  }
-  lastTimeSync = millis();
+  // WiFi and the time sync wait for the first cycle that has something to
+  // fetch. The clock keeps running through deep sleep, so until then the
+  // local time only needs the time zone, for the sleep schedule.
+  setenv("TZ", TIMEZONE, 1);
+  tzset();
 
   Serial.println("setup done");
 }
@@ -90,69 +141,158 @@ void setup() {
 void loop() {
   uint32_t start = millis();
 
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("Reconnecting to WiFi");
-    WiFi.reconnect();
-  }
+  // What apps left fetching by the last cycle fetched after the deadline is
+  // kept as if they had made it. Any still fetching carry on, and are shown
+  // from their last good data this cycle.
+  commitLateFetches(0);
+  time_t now = time(NULL);
 
-  if (millis() - lastTimeSync > 60 * 60 * 1000) {
-    Serial.println("Re-synchronizing time");
-    waitForSNTPSync();
-    lastTimeSync = millis();
+  // Fetch the apps whose data is due, the others draw what they last fetched
+  IApp* dueApps[numApps];
+  int dueIndices[numApps];
+  int numDue = 0;
+  for (int i = 0; i < numApps; i++) {
+    if (!isDue(i, now) && apps[i]->restoreData(false)) {
+      Serial.printf("App %d not due, using data fetched %ld seconds ago\n", i,
+                    (long)(now - lastFetched[i]));
+      continue;
+    }
+    dueApps[numDue] = apps[i];
+    dueIndices[numDue++] = i;
   }
-
-  // Fetch
-  // ORIGINAL app->fetchData();
-  /*
-  for (IApp* app : apps) {
-      app->fetchData();
+  if (numDue == 0) {
+    Serial.println("No app is due, nothing to fetch");
+  } else if (!goOnline()) {
+    return;
+  } else {
+    // The first time sync of a wake may have moved the clock
+    now = time(NULL);
   }
-  */
-  // Fetch data for all apps
-  for (int i = 0; i < numApps; i++) {
-    apps[i]->fetchData();
-  } 
 
+  // Apps only stage what they fetch, so one that misses the budget can keep
+  // fetching in the background while its last good data is drawn
+  fetchStatus_t statuses[numApps];
+  fetchExecutor.run(dueApps, numDue, FETCH_CYCLE_BUDGET, statuses);
+  for (int j = 0; j < numDue; j++) {
+    int i = dueIndices[j];
+    if (statuses[j] == FETCH_OK) {
+      apps[i]->commitData();
+      lastFetched[i] = now;
+      continue;
+    }
+    Serial.printf("App %d %s, showing its last good data\n", i,
+                  statuses[j] == FETCH_TIMED_OUT ? "missed the fetch deadline"
+                                                 : "failed to fetch");
+    if (!apps[i]->restoreData(true)) {
+      Serial.printf("App %d has no data to show\n", i);
+    }
+  }
 
   uint32_t fetchComplete = millis();
   Serial.printf("Fetched data in %lu millis.\n", fetchComplete - start);
 
+  // Skip the refresh entirely if it would draw exactly what is on the display
+  Rect dirtyArea = findDirtyArea();
+  if (dirtyArea.empty()) {
+    skippedRefreshCount++;
+    Serial.printf("Content unchanged, skipped refresh. Total time taken: %lu "
+                  "millis. Skipped refreshes: %lu\n",
+                  millis() - start, skippedRefreshCount);
+    logHeapUsage();
+    sleep();
+    return;
+  }
+
   // Render
-  initDisplay();
-  do {
-    display.fillScreen(GxEPD_WHITE);
-    // display.drawRect(X_MARGIN, Y_MARGIN, display.width() - X_MARGIN * 2,
-    //                  display.height() - Y_MARGIN * 2, GxEPD_BLACK);
-    // margin for ikea frame
-    //ORIGINAL app->render();
-    /*
-    // Render bus information
-    bus.render();
-    
-    // Set render area for weather and render
-    weather.setRenderArea(X_MARGIN, Y_MARGIN, display.width() / 3, display.height() / 3);
-    weather.render();
-    */
-    
-    // Set render areas for each app
-    bus.setRenderArea(X_MARGIN, display.height() / 2 , display.width() - X_MARGIN, display.height() - Y_MARGIN);
-    weather.setRenderArea(X_MARGIN, Y_MARGIN , display.width() - X_MARGIN , display.height() / 2);
-    
-    // Render all apps
-    for (int i = 0; i < numApps; i++) {
-      apps[i]->render();
-    }
-  } while (display.nextPage());
+  startFrame();
+  for (int i = 0; i < numApps; i++) {
+    apps[i]->render();
+  }
+  refreshDisplay(dirtyArea);
 
   uint32_t renderComplete = millis();
-  Serial.printf("Rendered data in %lu millis. Total time taken: %lu millis.\n",
-                renderComplete - fetchComplete, renderComplete - start);
+  Serial.printf("Rendered data in %lu millis. Total time taken: %lu millis. "
+                "Skipped refreshes: %lu\n",
+                renderComplete - fetchComplete, renderComplete - start,
+                skippedRefreshCount);
+  logHeapUsage();
 
   sleep();
 }
 
-/* Initialize e-paper display */
-void initDisplay() {
+/* Commits what the apps left fetching by an earlier cycle have fetched since,
+ * waiting up to timeoutMs for them. Each is recorded as fetched when its fetch
+ * finished. Returns how many are still fetching. */
+size_t commitLateFetches(uint32_t timeoutMs) {
+  IApp* lateApps[MAX_FETCH_TASKS];
+  time_t finishTimes[MAX_FETCH_TASKS];
+  size_t numLate = fetchExecutor.wait(timeoutMs, lateApps, finishTimes);
+  for (size_t j = 0; j < numLate; j++) {
+    for (int i = 0; i < numApps; i++) {
+      if (apps[i] == lateApps[j]) {
+        Serial.printf("App %d finished fetching after the deadline\n", i);
+        apps[i]->commitData();
+        lastFetched[i] = finishTimes[j];
+      }
+    }
+  }
+  return fetchExecutor.numRunning();
+}  // end commitLateFetches
+
+/* Whether an app's data is old enough to fetch again. Data restored from
+ * before a reset is never trusted, as the clock may not have been kept. */
+bool isDue(int app, time_t now) {
+  uint32_t maxAge = apps[app]->maxAge();
+  if (lastFetched[app] == 0 || maxAge == 0) {
+    return true;
+  }
+  if (maxAge == MAX_AGE_NEVER) {
+    return false;
+  }
+  // time_t may be 32 bits, where a large max age would not fit
+  int64_t age = (int64_t)now - lastFetched[app];
+  return age + FETCH_AGE_SLACK >= (int64_t)maxAge;
+}  // end isDue
+
+/* Brings up WiFi and synchronizes the clock the first time anything is
+ * fetched in a wake, and keeps both up on later cycles. Shows the error and
+ * sleeps if either can't be done the first time. Returns true once online. */
+bool goOnline() {
+  if (!wifiStarted) {
+    wl_status_t wifiStatus = startWiFi();
+    if (wifiStatus != WL_CONNECTED) {  // WiFi Connection Failed
+      handleFatalError(epd_bitmap_wifi_off, wifiStatus == WL_NO_SSID_AVAIL
+                                                ? "Network Not Available"
+                                                : "Wifi Connection Failed");
+      return false;
+    }
+    wifiStarted = true;
+  } else if (WiFi.status() != WL_CONNECTED) {
+    Serial.println("Reconnecting to WiFi");
+    WiFi.reconnect();
+  }
+
+  // TIME SYNCHRONIZATION
+  if (!timeSynchronized) {
+    configTzTime(TIMEZONE, NTP_SERVER_1, NTP_SERVER_2);
+    if (!waitForSNTPSync()) {
+      handleFatalError(epd_bitmap_wifi_off, "Time Synchronization Failed");
+      return false;
+    }
+    timeSynchronized = true;
+    lastTimeSync = millis();
+  } else if (millis() - lastTimeSync > 60 * 60 * 1000) {
+    Serial.println("Re-synchronizing time");
+    waitForSNTPSync();
+    lastTimeSync = millis();
+  }
+  return true;
+}  // end goOnline
+
+/* Initialize e-paper display. A partial refresh only updates the window, or
+ * the whole display if the window is empty. Returns the area that will be
+ * refreshed. */
+Rect initDisplay(const Rect& window, bool& fullRefresh) {
   if (!displayInitialized) {
 #ifdef DRIVER_WAVESHARE
     display.init(115200, true, 2, false);
@@ -172,32 +312,160 @@ void initDisplay() {
   display.setTextSize(1);
   display.setTextColor(GxEPD_BLACK);
   display.setTextWrap(false);
-  if (partialRefreshCount == 0 || partialRefreshCount > 10) {
+  Rect area = {0, 0, display.width(), display.height()};
+  fullRefresh = partialRefreshCount == 0 || partialRefreshCount > 10;
+  if (fullRefresh) {
     Serial.println("Full refresh");
     display.setFullWindow();
     partialRefreshCount = 1;
   } else {
-    Serial.println("Partial refresh " + String(partialRefreshCount));
-    display.setPartialWindow(0, 0, display.width(), display.height());
+    // The controller addresses the window in whole bytes of 8 pixels
+    if (!window.empty()) {
+      area = window.alignedTo(8).intersect(area);
+    }
+    Serial.printf("Partial refresh %d of %dx%d at %d,%d\n",
+                  partialRefreshCount, area.w, area.h, area.x, area.y);
+    display.setPartialWindow(area.x, area.y, area.w, area.h);
     partialRefreshCount++;
   }
-  display.firstPage();
-  return;
+  return area;
 }  // end initDisplay
 
+/* Start drawing a new frame into the display list */
+void startFrame() {
+  displayList.clear();
+  displayList.setFont(NULL);
+  displayList.setTextSize(1);
+  displayList.setTextColor(GxEPD_BLACK);
+  displayList.setTextWrap(false);
+}  // end startFrame
+
+/* Refresh the display with what was drawn into the display list. Only the
+ * operations that reach into the refreshed area are replayed. The frame is
+ * drawn in one pass if there is room for it, otherwise once per page. */
+void refreshDisplay(const Rect& window) {
+  bool fullRefresh;
+  Rect area = initDisplay(window, fullRefresh);
+  Serial.printf("Replaying %u drawing operations\n",
+                (unsigned)displayList.size());
+  uint32_t start = millis();
+  if (frameBuffer.allocate(FULL_FRAME_HEAP_RESERVE)) {
+    frameBuffer.setRotation(display.getRotation());
+    frameBuffer.fillScreen(GxEPD_WHITE);
+    displayList.replay(frameBuffer, area);
+    uint32_t drawn = millis();
+    writeFrame(area, fullRefresh);
+    Serial.printf("Drew the frame in one pass (%s) in %lu millis, sent and "
+                  "refreshed in %lu millis\n",
+                  frameBuffer.inPsram() ? "PSRAM" : "RAM", drawn - start,
+                  millis() - drawn);
+    frameBuffer.release();
+    return;
+  }
+
+  display.firstPage();
+  do {
+    display.fillScreen(GxEPD_WHITE);
+    displayList.replay(display, area);
+  } while (display.nextPage());
+  Serial.printf("Drew the frame page by page in %lu millis\n",
+                millis() - start);
+}  // end refreshDisplay
+
+/* Send the frame buffer to the panel and refresh it, the same way GxEPD2 does
+ * with its last page. The area is in rotated coordinates. */
+void writeFrame(const Rect& area, bool fullRefresh) {
+  const uint8_t* buffer = frameBuffer.buffer();
+  const int16_t w = GxEPD2_750_T7::WIDTH;
+  const int16_t h = GxEPD2_750_T7::HEIGHT;
+  if (fullRefresh) {
+    display.epd2.writeImageForFullRefresh(buffer, 0, 0, w, h);
+    display.epd2.refresh(false);
+    // Keep the controller's copy of the old image for the next partial refresh
+    display.epd2.writeImageAgain(buffer, 0, 0, w, h);
+    return;
+  }
+  Rect panel = frameBuffer.toPanel(area);
+  display.epd2.writeImagePart(buffer, panel.x, panel.y, w, h, panel.x, panel.y,
+                              panel.w, panel.h);
+  display.epd2.refresh(panel.x, panel.y, panel.w, panel.h);
+  display.epd2.writeImagePartAgain(buffer, panel.x, panel.y, w, h, panel.x,
+                                   panel.y, panel.w, panel.h);
+}  // end writeFrame
+
+/* Gives each app its region of the screen */
+void layoutApps() {
+  Rect appAreas[numApps];
+  resolveLayout({X_MARGIN, Y_MARGIN,
+                 (int16_t)(displayList.width() - 2 * X_MARGIN),
+                 (int16_t)(displayList.height() - 2 * Y_MARGIN)},
+                appRegions, numApps, appAreas);
+  for (int i = 0; i < numApps; i++) {
+    apps[i]->setRenderArea(appAreas[i]);
+  }
+}  // end layoutApps
+
+/* Returns the smallest rectangle covering every region that would be drawn
+ * differently to the last refresh, including regions that are no longer drawn
+ * at all. Returns an empty rectangle if nothing changed. */
+Rect findDirtyArea() {
+  Rect dirty = {0, 0, 0, 0};
+  for (int i = 0; i < numApps; i++) {
+    appDigests current;
+    current.numRegions = apps[i]->digestRegions(current.regions,
+                                                current.digests);
+    const appDigests& last = lastDigests[i];
+    for (int j = 0; j < max(current.numRegions, last.numRegions); j++) {
+      bool inCurrent = j < current.numRegions;
+      bool inLast = j < last.numRegions;
+      if (inCurrent && inLast && current.regions[j] == last.regions[j] &&
+          current.digests[j] == last.digests[j]) {
+        continue;
+      }
+      if (inCurrent) {
+        dirty = dirty.unite(current.regions[j]);
+      }
+      if (inLast) {
+        dirty = dirty.unite(last.regions[j]);
+      }
+    }
+    lastDigests[i] = current;
+  }
+  return dirty;
+}  // end findDirtyArea
+
+/* Log heap usage at the end of a cycle, so that churn and fragmentation can
+ * be tracked over long uptimes */
+void logHeapUsage() {
+  Serial.printf("Heap free: %lu bytes, lowest free: %lu bytes, largest "
+                "block: %lu bytes\n",
+                (unsigned long)ESP.getFreeHeap(),
+                (unsigned long)ESP.getMinFreeHeap(),
+                (unsigned long)ESP.getMaxAllocHeap());
+}  // end logHeapUsage
+
 void handleFatalError(const uint8_t* bitmap_196x196, const String& errMsgLn1,
                       const String& errMsgLn2) {
   Serial.println(errMsgLn1);
-  initDisplay();
-  do {
-    renderer.drawError(bitmap_196x196, errMsgLn1, errMsgLn2);
-  } while (display.nextPage());
+  // The error replaces whatever the apps drew
+  memset(lastDigests, 0, sizeof(lastDigests));
+  startFrame();
+  renderer.drawError(bitmap_196x196, errMsgLn1, errMsgLn2);
+  refreshDisplay();
   sleep(true);
 }
 
 void sleep(bool forceDeepSleep) {
   uint64_t sleepDuration = calculateSleepDuration();
   if (forceDeepSleep || sleepDuration > DEEP_SLEEP_THRESHOLD) {
+    // Fetch tasks don't survive deep sleep. Late fetches get a last chance to
+    // finish, so that what they fetched is saved for the next wake, and any
+    // that don't are given up on.
+    size_t numGivenUp = commitLateFetches(LATE_FETCH_GRACE);
+    if (numGivenUp > 0) {
+      Serial.printf("Giving up on %u fetches still running\n",
+                    (unsigned)numGivenUp);
+    }
     powerOffDisplay();
     Serial.println("Entering deep sleep for " + String(sleepDuration) + "s");
     esp_sleep_enable_timer_wakeup(sleepDuration * 1000000ULL);
@@ -24,27 +24,27 @@
 #include "config.h"
 #include "display_utils.h"
 #include "icons.h"
+#include "status_icons.h"
 
-Renderer::Renderer(GxEPD2_GFX &display) : _display(display) {}
+Renderer::Renderer(DisplayList &display) : _display(display) {
+  for (int i = 0; i < STATUS_ICON_SPRITES; i++) {
+    _batterySprites[i].level = -1;
+    _wifiSprites[i].level = -1;
+  }
+}
 
 /*
  * Returns the string width in pixels
  */
 uint16_t Renderer::getStringWidth(const String &text) {
-  int16_t x1, y1;
-  uint16_t w, h;
-  _display.getTextBounds(text, 0, 0, &x1, &y1, &w, &h);
-  return w;
+  return _display.measureText(text.c_str()).w;
 }
 
 /*
  * Returns the string height in pixels
  */
 uint16_t Renderer::getStringHeight(const String &text) {
-  int16_t x1, y1;
-  uint16_t w, h;
-  _display.getTextBounds(text, 0, 0, &x1, &y1, &w, &h);
-  return h;
+  return _display.measureText(text.c_str()).h;
 }
 
 /*
@@ -52,9 +52,7 @@ uint16_t Renderer::getStringHeight(const String &text) {
  */
 void Renderer::drawString(int16_t x, int16_t y, const String &text,
                           alignment_t alignment) {
-  int16_t x1, y1;
-  uint16_t w, h;
-  _display.getTextBounds(text, x, y, &x1, &y1, &w, &h);
+  uint16_t w = _display.measureText(text.c_str()).w;
   if (alignment == RIGHT) {
     x = x - w;
   }
@@ -78,112 +76,68 @@ void Renderer::drawString(int16_t x, int16_t y, const String &text,
  *       max_width exist in text, then the string will be printed beyond
  *       max_width.
  */
-int16_t Renderer::drawMultiLnString(int16_t x, int16_t y, const String &text,
+int16_t Renderer::drawMultiLnString(int16_t x, int16_t y, const char *text,
                                     alignment_t alignment, uint16_t max_width,
                                     uint16_t max_lines, int16_t line_spacing) {
   uint16_t current_line = 0;
-  String textRemaining = text;
   // print until we reach max_lines or no more text remains
-  while (current_line < max_lines && !textRemaining.isEmpty()) {
-    int16_t x1, y1;
-    uint16_t w, h;
-
-    _display.getTextBounds(textRemaining, 0, 0, &x1, &y1, &w, &h);
-
-    int endIndex = textRemaining.length();
-    // check if remaining text is to wide, if it is then print what we can
-    String subStr = textRemaining;
-    int splitAt = 0;
-    int keepLastChar = 0;
-    while (w > max_width && splitAt != -1) {
-      if (keepLastChar) {
-        // if we kept the last character during the last iteration of this while
-        // loop, remove it now so we don't get stuck in an infinite loop.
-        subStr.remove(subStr.length() - 1);
-      }
-
-      // find the last place in the string that we can break it.
-      if (current_line < max_lines - 1) {
-        splitAt = std::max(subStr.lastIndexOf(" "), subStr.lastIndexOf("-"));
-      } else {
-        // this is the last line, only break at spaces so we can add ellipsis
-        splitAt = subStr.lastIndexOf(" ");
-      }
-
-      // if splitAt == -1 then there is an unbroken set of characters that is
-      // longer than max_width. Otherwise if splitAt != -1 then we can continue
-      // the loop until the string is <= max_width
-      if (splitAt != -1) {
-        endIndex = splitAt;
-        subStr = subStr.substring(0, endIndex + 1);
-
-        char lastChar = subStr.charAt(endIndex);
-        if (lastChar == ' ') {
-          // remove this char now so it is not counted towards line width
-          keepLastChar = 0;
-          subStr.remove(endIndex);
-          --endIndex;
-        } else if (lastChar == '-') {
-          // this char will be printed on this line and removed next iteration
-          keepLastChar = 1;
-        }
-
-        if (current_line < max_lines - 1) {
-          // this is not the last line
-          _display.getTextBounds(subStr, 0, 0, &x1, &y1, &w, &h);
-        } else {
-          // this is the last line, we need to make sure there is space for
-          // ellipsis
-          _display.getTextBounds(subStr + "...", 0, 0, &x1, &y1, &w, &h);
-          if (w <= max_width) {
-            // ellipsis fit, add them to subStr
-            subStr = subStr + "...";
-          }
-        }
-
-      }  // end if (splitAt != -1)
-    }  // end inner while
-
-    drawString(x, y + (current_line * line_spacing), subStr, alignment);
-
-    // update textRemaining to no longer include what was printed
-    // +1 for exclusive bounds, +1 to get passed space/dash
-    textRemaining = textRemaining.substring(endIndex + 2 - keepLastChar);
-
+  while (current_line < max_lines && *text != '\0') {
+    textLine line = _display.breakLine(text, max_width,
+                                       current_line == max_lines - 1);
+    drawTextLine(x, y + (current_line * line_spacing), text, line, alignment);
+    text = line.next;
     ++current_line;
-  }  // end outer while
+  }
 
   return current_line;
 }  // end drawMultiLnString
 
+/*
+ * Draws one line of text broken by breakLine() with alignment
+ */
+void Renderer::drawTextLine(int16_t x, int16_t y, const char *text,
+                            const textLine &line, alignment_t alignment) {
+  if (alignment == RIGHT) {
+    x = x - line.width;
+  }
+  if (alignment == CENTER) {
+    x = x - line.width / 2;
+  }
+  _display.setCursor(x, y);
+  _display.write((const uint8_t *)text, line.end - text);
+  if (line.ellipsis) {
+    _display.print("...");
+  }
+}  // end drawTextLine
+
 /* This function is responsible for drawing the status bar along the bottom of
  * the display.
  *
  * Returns the height of the status bar (above the baseline)
  */
-int16_t Renderer::drawStatusBar(int16_t yBaseline, time_t lastUpdatedTime,
-                                int rssi, uint32_t batPercent) {
-  
-  Serial.printf("drawtatusbar: yBaseline is %lu", yBaseline);
-
+int16_t Renderer::drawStatusBar(int16_t xRight, int16_t yBaseline,
+                                time_t lastUpdatedTime, int rssi,
+                                uint32_t batPercent) {
   String dataStr;
   _display.setFont(&FreeSans9pt7b);
-  int pos = _display.width() - X_MARGIN - 8;
+  int pos = xRight - 8;
   const int16_t sp = 12;
-  const int16_t iconSize = 18;
+  const int16_t iconSize = STATUS_ICON_SIZE;
 
   // Battery
   dataStr = String(batPercent) + "%";
   drawString(pos, yBaseline - 2, dataStr, RIGHT);
   pos -= getStringWidth(dataStr) + iconSize + 2;
-  drawBattery(pos, yBaseline - 16, iconSize, iconSize, batPercent);
+  drawSprite(_batterySprites, drawBattery, batteryLevel(iconSize, batPercent),
+             pos, yBaseline - 16);
 
   // WiFi
   pos -= sp;
   dataStr = String(getWiFiDesc(rssi));
   drawString(pos, yBaseline - 2, dataStr, RIGHT);
   pos -= getStringWidth(dataStr) + iconSize + 2;
-  drawWifi(pos, yBaseline - 16, iconSize, iconSize, rssi);
+  drawSprite(_wifiSprites, drawWifi, wifiLevel(iconSize, iconSize, rssi), pos,
+             yBaseline - 16);
 
   // Last Refresh
   pos -= sp;
@@ -195,9 +149,28 @@ int16_t Renderer::drawStatusBar(int16_t yBaseline, time_t lastUpdatedTime,
   _display.drawInvertedBitmap(pos, yBaseline - 20, epd_bitmap_refresh, 24, 24,
                               GxEPD_BLACK);
 
-  return 18;
+  return STATUS_BAR_HEIGHT;
 }  // end drawStatusBar
 
+/* Marks data that could not be refreshed this cycle and is drawn from the last
+ * successful fetch.
+ */
+void Renderer::drawStaleMarker(int16_t x, int16_t yBaseline,
+                               alignment_t alignment) {
+  const char *text = "Not updated";
+  _display.setFont(&FreeSans9pt7b);
+  int16_t width = 24 + 4 + getStringWidth(text);
+  if (alignment == RIGHT) {
+    x -= width;
+  }
+  if (alignment == CENTER) {
+    x -= width / 2;
+  }
+  _display.drawInvertedBitmap(x, yBaseline - 18, epd_bitmap_warning, 24, 24,
+                              GxEPD_BLACK);
+  drawString(x + 24 + 4, yBaseline - 2, text, LEFT);
+}  // end drawStaleMarker
+
 /* This function is responsible for drawing prominent error messages to the
  * screen.
  *
@@ -206,95 +179,53 @@ int16_t Renderer::drawStatusBar(int16_t yBaseline, time_t lastUpdatedTime,
  */
 void Renderer::drawError(const uint8_t *bitmap_192x192, const String &errMsgLn1,
                          const String &errMsgLn2) {
+  drawErrorAt(_display.width() / 2, _display.height() / 2,
+              _display.width() - 2 * X_MARGIN, bitmap_192x192, errMsgLn1,
+              errMsgLn2);
+}  // end drawError
+
+/* Draws the error centred in area rather than on the whole screen, with room
+ * for the icon and two lines of text. */
+void Renderer::drawError(const Rect &area, const uint8_t *bitmap_192x192,
+                         const String &errMsgLn1, const String &errMsgLn2) {
+  const int16_t iconSize = 192;
+  // From the top of the icon to below the descenders of the second line
+  const int16_t height = iconSize + 21 + 21 + 55 + 12;
+  int16_t top = area.y + (area.h > height ? (area.h - height) / 2 : 0);
+  drawErrorAt(area.x + area.w / 2, top + iconSize / 2 + 21, area.w,
+              bitmap_192x192, errMsgLn1, errMsgLn2);
+}  // end drawError
+
+/* The icon centred on x,y, with the message below it */
+void Renderer::drawErrorAt(int16_t x, int16_t y, uint16_t maxWidth,
+                           const uint8_t *bitmap_192x192,
+                           const String &errMsgLn1, const String &errMsgLn2) {
   const uint16_t iconSize = 192;
-  const uint16_t displayWidth = _display.width();
-  const uint16_t displayHeight = _display.height();
   _display.setFont(&FreeSans24pt7b);
   if (!errMsgLn2.isEmpty()) {
-    drawString(displayWidth / 2, displayHeight / 2 + iconSize / 2 + 21,
-               errMsgLn1, CENTER);
-    drawString(displayWidth / 2, displayHeight / 2 + iconSize / 2 + 21 + 55,
-               errMsgLn2, CENTER);
+    drawString(x, y + iconSize / 2 + 21, errMsgLn1, CENTER);
+    drawString(x, y + iconSize / 2 + 21 + 55, errMsgLn2, CENTER);
   } else {
-    drawMultiLnString(displayWidth / 2, displayHeight / 2 + iconSize / 2 + 21,
-                      errMsgLn1, CENTER, displayWidth - 2 * X_MARGIN, 2, 55);
+    drawMultiLnString(x, y + iconSize / 2 + 21, errMsgLn1.c_str(), CENTER,
+                      maxWidth, 2, 55);
   }
-  _display.drawInvertedBitmap(displayWidth / 2 - iconSize / 2,
-                              displayHeight / 2 - iconSize / 2 - 21,
+  _display.drawInvertedBitmap(x - iconSize / 2, y - iconSize / 2 - 21,
                               bitmap_192x192, iconSize, iconSize, GxEPD_BLACK);
-  return;
-}  // end drawError
-
-void Renderer::drawBattery(int16_t x, int16_t y, int16_t w, int16_t h,
-                           uint32_t batPercent) {
-  int16_t strokeWidth = 2;
-  int16_t xIndent = w / 24;
-  int16_t yIndent = h / 4;
-  int16_t batteryThickness = h - 2 * yIndent;
-  int16_t bumpIndent = batteryThickness / 4;
-  int16_t bumpWidth = batteryThickness - 2 * bumpIndent;
-  int16_t bumpLength = w / 8;
-  int16_t batteryLength = w - bumpLength - 2 * xIndent;
-  // Main Battery
-  _display.fillRect(x + xIndent, y + yIndent, batteryLength, batteryThickness,
-                    GxEPD_BLACK);
-  int16_t emptyLength =
-      ceil(((batteryLength - 2 * strokeWidth) * (100 - batPercent)) / 100.0);
-  _display.fillRect(x + xIndent + batteryLength - strokeWidth - emptyLength,
-                    y + yIndent + strokeWidth, emptyLength,
-                    batteryThickness - 2 * strokeWidth, GxEPD_WHITE);
+}  // end drawErrorAt
 
-  // Bump
-  _display.fillRect(x + xIndent + batteryLength, y + yIndent + bumpIndent,
-                    bumpLength, bumpWidth, GxEPD_BLACK);
-}
-
-void Renderer::drawArc(int16_t cx, int16_t cy, double startAngle,
-                       double endAngle, int16_t innerRadius,
-                       int16_t outerRadius) {
-  for (int16_t y = -outerRadius; y <= outerRadius; y++) {
-    for (int16_t x = -outerRadius; x <= outerRadius; x++) {
-      int32_t distSquared = x * x + y * y;
-      double angle = atan2(-y, x);
-      if (distSquared <= outerRadius * outerRadius &&
-          distSquared > innerRadius * innerRadius &&
-          isAngleInArc(angle, startAngle, endAngle)) {
-        _display.drawPixel(cx + x, cy + y, GxEPD_BLACK);
-      }
-    }
-  }
-}
-
-inline boolean Renderer::isAngleInArc(double angle, double startAngle,
-                                      double endAngle) {
-  if (startAngle > endAngle) {
-    return angle > startAngle || angle < endAngle;
+/*
+ * Draws a status bar icon at x,y from the sprite for its level, drawing the
+ * sprite first if that level isn't cached. Each level has one slot, so the
+ * cache never needs searching.
+ */
+void Renderer::drawSprite(iconSprite sprites[], drawIcon_t draw, int16_t level,
+                          int16_t x, int16_t y) {
+  iconSprite &sprite = sprites[level % STATUS_ICON_SPRITES];
+  if (sprite.level != level) {
+    drawIconSprite(sprite.bitmap, draw, level);
+    sprite.level = level;
   }
-  return angle > startAngle && angle < endAngle;
+  // The icons are black on white, and the white is left as it is
+  _display.drawInvertedBitmap(x, y, sprite.bitmap, STATUS_ICON_SIZE,
+                              STATUS_ICON_SIZE, GxEPD_BLACK);
 }
-
-void Renderer::drawWifi(int16_t x, int16_t y, int16_t w, int16_t h, int rssi) {
-  int16_t xIndent = w / 12;
-  int16_t yIndent = h / 8;
-  int16_t cx = x + w / 2;
-  int16_t cy = y + h - yIndent;
-
-  // Recall that angles are measured anti-clockwise
-  double startAngle = atan2(h - 3 * yIndent, w / 2 - xIndent);
-  double endAngle = atan2(h - 3 * yIndent, xIndent - w / 2);
-
-  int16_t radius = ceil(hypot(w / 2 - xIndent, h - 3 * yIndent));
-  float wifiFrac = getWifiFrac(rssi);
-  int16_t wifiRadius = ceil(radius * wifiFrac);
-
-  // Draw outline
-  drawArc(cx, cy, startAngle, endAngle, radius - 1, radius + 1);
-  _display.drawLine(cx, cy, x + xIndent, y + 2 * yIndent, GxEPD_BLACK);
-  _display.drawLine(cx, cy - 1, x + xIndent + 1, y + 2 * yIndent, GxEPD_BLACK);
-  _display.drawLine(cx, cy, x + w - xIndent, y + 2 * yIndent, GxEPD_BLACK);
-  _display.drawLine(cx, cy - 1, x + w - xIndent - 1, y + 2 * yIndent,
-                    GxEPD_BLACK);
-
-  // Draw wifi strength
-  drawArc(cx, cy, startAngle, endAngle, 0, wifiRadius);
-}
\ No newline at end of file
@@ -0,0 +1,88 @@
+// TCP connections with a bounded connect time.
+
+#include "socket_connect.h"
+
+#include <Arduino.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/*
+ * Waits up to timeout millis for a non-blocking connect to finish.
+ *
+ * Returns 0 once connected, otherwise the errno of the failure.
+ */
+static int waitForConnect(int fd, int32_t timeout) {
+  fd_set writable;
+  FD_ZERO(&writable);
+  FD_SET(fd, &writable);
+  struct timeval tv = {timeout / 1000, (timeout % 1000) * 1000};
+  int ret = select(fd + 1, NULL, &writable, NULL, &tv);
+  if (ret < 0) {
+    return errno;
+  }
+  if (ret == 0) {
+    return ETIMEDOUT;
+  }
+  int error = 0;
+  socklen_t length = sizeof(error);
+  if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0) {
+    return errno;
+  }
+  return error;
+}
+
+/*
+ * Opens a TCP connection the way start_ssl_client does: the connect gives up
+ * after timeout millis (30 s if it is not positive), and the socket is left
+ * blocking with the same timeout on every send and receive, no Nagle delay
+ * and keepalive on.
+ *
+ * Returns the socket, or -1 if the host could not be reached.
+ */
+int connectSocket(const char *host, uint16_t port, int32_t timeout) {
+  if (timeout <= 0) {
+    timeout = 30000;
+  }
+  struct addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo *address = NULL;
+  if (getaddrinfo(host, NULL, &hints, &address) != 0 || address == NULL) {
+    Serial.printf("Could not resolve %s\n", host);
+    return -1;
+  }
+  struct sockaddr_in server = *(struct sockaddr_in *)address->ai_addr;
+  freeaddrinfo(address);
+  server.sin_port = htons(port);
+
+  int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (fd < 0) {
+    Serial.printf("Could not open socket: %d\n", errno);
+    return -1;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  int error = 0;
+  if (connect(fd, (struct sockaddr *)&server, sizeof(server)) < 0) {
+    error = errno == EINPROGRESS ? waitForConnect(fd, timeout) : errno;
+  }
+  if (error != 0) {
+    Serial.printf("Could not connect to %s:%u: %d\n", host, port, error);
+    close(fd);
+    return -1;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) & ~O_NONBLOCK);
+
+  struct timeval tv = {timeout / 1000, (timeout % 1000) * 1000};
+  int enable = 1;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+  setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &enable, sizeof(enable));
+  return fd;
+}
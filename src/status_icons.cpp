@@ -0,0 +1,92 @@
+// The battery and WiFi icons of the status bar.
+
+#include "status_icons.h"
+
+#include <GxEPD2.h>
+#include <math.h>
+#include <string.h>
+
+#include "arc.h"
+#include "display_utils.h"
+
+/*
+ * Draws an icon at the given level into a sprite, a STATUS_ICON_SIZE square
+ * bitmap with a clear bit for each black pixel, as drawInvertedBitmap() takes.
+ */
+void drawIconSprite(uint8_t bitmap[], drawIcon_t draw, int16_t level) {
+  GFXcanvas1 canvas(STATUS_ICON_SIZE, STATUS_ICON_SIZE);
+  canvas.fillScreen(GxEPD_WHITE);
+  draw(canvas, 0, 0, STATUS_ICON_SIZE, STATUS_ICON_SIZE, level);
+  memcpy(bitmap, canvas.getBuffer(), STATUS_ICON_BYTES);
+}
+
+/*
+ * Returns the length of the empty part of a battery w wide, which is all
+ * that changes with the charge.
+ */
+int16_t batteryLevel(int16_t w, uint32_t batPercent) {
+  int16_t strokeWidth = 2;
+  int16_t xIndent = w / 24;
+  int16_t bumpLength = w / 8;
+  int16_t batteryLength = w - bumpLength - 2 * xIndent;
+  return ((batteryLength - 2 * strokeWidth) * (100 - batPercent) + 99) / 100;
+}
+
+void drawBattery(Adafruit_GFX &gfx, int16_t x, int16_t y, int16_t w,
+                 int16_t h, int16_t emptyLength) {
+  int16_t strokeWidth = 2;
+  int16_t xIndent = w / 24;
+  int16_t yIndent = h / 4;
+  int16_t batteryThickness = h - 2 * yIndent;
+  int16_t bumpIndent = batteryThickness / 4;
+  int16_t bumpWidth = batteryThickness - 2 * bumpIndent;
+  int16_t bumpLength = w / 8;
+  int16_t batteryLength = w - bumpLength - 2 * xIndent;
+  // Main Battery
+  gfx.fillRect(x + xIndent, y + yIndent, batteryLength, batteryThickness,
+               GxEPD_BLACK);
+  gfx.fillRect(x + xIndent + batteryLength - strokeWidth - emptyLength,
+               y + yIndent + strokeWidth, emptyLength,
+               batteryThickness - 2 * strokeWidth, GxEPD_WHITE);
+
+  // Bump
+  gfx.fillRect(x + xIndent + batteryLength, y + yIndent + bumpIndent,
+               bumpLength, bumpWidth, GxEPD_BLACK);
+}
+
+/*
+ * Returns the radius of the filled part of a w by h WiFi icon, which is all
+ * that changes with the signal strength.
+ */
+int16_t wifiLevel(int16_t w, int16_t h, int rssi) {
+  int16_t xIndent = w / 12;
+  int16_t yIndent = h / 8;
+  int16_t radius = ceil(hypot(w / 2 - xIndent, h - 3 * yIndent));
+  return ceil(radius * getWifiFrac(rssi));
+}
+
+void drawWifi(Adafruit_GFX &gfx, int16_t x, int16_t y, int16_t w, int16_t h,
+              int16_t wifiRadius) {
+  int16_t xIndent = w / 12;
+  int16_t yIndent = h / 8;
+  int16_t cx = x + w / 2;
+  int16_t cy = y + h - yIndent;
+
+  // The directions of the edges, anti-clockwise from the right one
+  int16_t edgeX = w / 2 - xIndent;
+  int16_t edgeY = h - 3 * yIndent;
+
+  int16_t radius = ceil(hypot(edgeX, edgeY));
+
+  // Draw outline
+  fillArc(gfx, cx, cy, edgeX, edgeY, -edgeX, edgeY, radius - 1, radius + 1,
+          GxEPD_BLACK);
+  gfx.drawLine(cx, cy, x + xIndent, y + 2 * yIndent, GxEPD_BLACK);
+  gfx.drawLine(cx, cy - 1, x + xIndent + 1, y + 2 * yIndent, GxEPD_BLACK);
+  gfx.drawLine(cx, cy, x + w - xIndent, y + 2 * yIndent, GxEPD_BLACK);
+  gfx.drawLine(cx, cy - 1, x + w - xIndent - 1, y + 2 * yIndent, GxEPD_BLACK);
+
+  // Draw wifi strength
+  fillArc(gfx, cx, cy, edgeX, edgeY, -edgeX, edgeY, 0, wifiRadius,
+          GxEPD_BLACK);
+}
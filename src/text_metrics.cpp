@@ -0,0 +1,153 @@
+#include "text_metrics.h"
+
+#include <string.h>
+
+textBounds measureText(const GFXfont *font, const char *text, uint8_t size) {
+  return measureText(font, text, text + strlen(text), size);
+}
+
+/*
+ * Walks the glyphs once, the same way Adafruit_GFX::charBounds() does. Glyphs
+ * without ink, such as spaces, still count towards the box.
+ */
+textBounds measureText(const GFXfont *font, const char *begin,
+                       const char *end, uint8_t size) {
+  int16_t minX = 0x7FFF, minY = 0x7FFF, maxX = -1, maxY = -1;
+  int16_t x = 0, y = 0;
+  for (const char *p = begin; p < end; p++) {
+    uint8_t c = *p;
+    if (c == '\n') {
+      x = 0;
+      y += size * (font ? (uint8_t)font->yAdvance : 8);
+      continue;
+    }
+    if (c == '\r') {
+      continue;
+    }
+
+    int16_t x1, y1, x2, y2;
+    if (font) {
+      if (c < font->first || c > font->last) {
+        continue;
+      }
+      const GFXglyph &glyph = font->glyph[c - font->first];
+      x1 = x + glyph.xOffset * size;
+      y1 = y + glyph.yOffset * size;
+      x2 = x1 + glyph.width * size - 1;
+      y2 = y1 + glyph.height * size - 1;
+      x += glyph.xAdvance * size;
+    } else {
+      x1 = x;
+      y1 = y;
+      x2 = x + size * 6 - 1;
+      y2 = y + size * 8 - 1;
+      x += size * 6;
+    }
+    if (x1 < minX) minX = x1;
+    if (y1 < minY) minY = y1;
+    if (x2 > maxX) maxX = x2;
+    if (y2 > maxY) maxY = y2;
+  }
+
+  textBounds bounds = {0, 0, 0, 0};
+  if (maxX >= minX) {
+    bounds.x = minX;
+    bounds.w = maxX - minX + 1;
+  }
+  if (maxY >= minY) {
+    bounds.y = minY;
+    bounds.h = maxY - minY + 1;
+  }
+  return bounds;
+}
+
+// The width of a line of text, measured a glyph at a time
+struct lineMeasure {
+  const GFXfont *font;
+  uint8_t size;
+  int16_t x;
+  int16_t minX;
+  int16_t maxX;
+
+  void add(uint8_t c) {
+    int16_t x1, x2;
+    if (font) {
+      if (c < font->first || c > font->last) {
+        return;
+      }
+      const GFXglyph &glyph = font->glyph[c - font->first];
+      x1 = x + glyph.xOffset * size;
+      x2 = x1 + glyph.width * size - 1;
+      x += glyph.xAdvance * size;
+    } else {
+      x1 = x;
+      x2 = x + size * 6 - 1;
+      x += size * 6;
+    }
+    if (x1 < minX) minX = x1;
+    if (x2 > maxX) maxX = x2;
+  }
+
+  uint16_t width() const { return maxX >= minX ? maxX - minX + 1 : 0; }
+};
+
+/*
+ * Finds the longest start of text that fits in maxWidth and ends at a break,
+ * walking the text once. Lines break before a space, which is dropped, or
+ * after a dash. The last line only breaks at spaces and ends with an ellipsis
+ * if the text doesn't all fit.
+ *
+ * If no break leaves a line that fits, the line ends at the first break, or
+ * takes the rest of the text if there is none, and is wider than maxWidth.
+ */
+textLine breakLine(const GFXfont *font, const char *text, uint16_t maxWidth,
+                   bool lastLine, uint8_t size) {
+  lineMeasure line = {font, size, 0, 0x7FFF, -1};
+  textLine best = {NULL, NULL, 0, false};
+  textLine first = {NULL, NULL, 0, false};
+
+  auto breakAt = [&](const char *end, const char *next) {
+    uint16_t width = line.width();
+    if (first.end == NULL) {
+      first = {end, next, width, false};
+    }
+    if (lastLine) {
+      lineMeasure withEllipsis = line;
+      withEllipsis.add('.');
+      withEllipsis.add('.');
+      withEllipsis.add('.');
+      width = withEllipsis.width();
+    }
+    if (width <= maxWidth) {
+      best = {end, next, width, lastLine};
+    }
+  };
+
+  const char *p = text;
+  bool fits = true;
+  for (; *p != '\0'; p++) {
+    if (*p == ' ') {
+      breakAt(p, p + 1);
+    }
+    line.add(*p);
+    if (*p == '-' && !lastLine) {
+      breakAt(p + 1, p + 1);
+    }
+    fits = fits && line.width() <= maxWidth;
+    // No later break can fit, but the first is still needed if none fits
+    if (!fits && first.end != NULL) {
+      break;
+    }
+  }
+
+  if (fits) {
+    return {p, p, line.width(), false};
+  }
+  if (best.end != NULL) {
+    return best;
+  }
+  if (first.end != NULL) {
+    return first;
+  }
+  return {p, p, line.width(), false};
+}
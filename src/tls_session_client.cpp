@@ -0,0 +1,193 @@
+// TLS session resumption across deep sleep.
+
+#include "tls_session_client.h"
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/ssl.h>
+
+#include "rtc_memory.h"
+#include "socket_connect.h"
+
+struct tlsSessionEntry {
+  char host[TLS_SESSION_HOST_LEN];
+  uint16_t length;
+  uint8_t data[TLS_SESSION_MAX_SIZE];
+};
+
+RTC_DATA_ATTR static tlsSessionEntry sessionCache[TLS_SESSION_CACHE_ENTRIES];
+RTC_DATA_ATTR static uint8_t nextSessionEntry = 0;
+static_assert(sizeof(sessionCache) + sizeof(nextSessionEntry) <=
+                  RTC_TLS_SESSIONS_SHARE,
+              "TLS sessions outgrow RTC_TLS_SESSIONS_SHARE");
+
+// Apps may connect from several fetch tasks at once
+static SemaphoreHandle_t sessionCacheLock() {
+  static SemaphoreHandle_t lock = xSemaphoreCreateMutex();
+  return lock;
+}
+
+/*
+ * Returns the cache entry for the host, claiming the oldest entry if the host
+ * has none yet. Must be called with the cache locked.
+ *
+ * An entry's length is only set once its data is complete, and cleared before
+ * anything else in it changes, so a fetch task cut off by deep sleep part way
+ * through leaves an empty entry rather than one that doesn't match its host.
+ */
+static tlsSessionEntry &getSessionEntry(const char *host) {
+  for (tlsSessionEntry &entry : sessionCache) {
+    if (strncmp(entry.host, host, sizeof(entry.host)) == 0) {
+      return entry;
+    }
+  }
+  tlsSessionEntry &entry =
+      sessionCache[nextSessionEntry++ % TLS_SESSION_CACHE_ENTRIES];
+  entry.length = 0;
+  strlcpy(entry.host, host, sizeof(entry.host));
+  return entry;
+}
+
+/*
+ * Hands the cached session for the host to mbedtls, which keeps its own copy.
+ *
+ * Returns true if a session was offered.
+ */
+static bool loadSession(const char *host, mbedtls_ssl_context *ssl) {
+  xSemaphoreTake(sessionCacheLock(), portMAX_DELAY);
+  tlsSessionEntry &entry = getSessionEntry(host);
+  bool offered = false;
+  if (entry.length > 0) {
+    mbedtls_ssl_session cached;
+    mbedtls_ssl_session_init(&cached);
+    offered = mbedtls_ssl_session_load(&cached, entry.data, entry.length) == 0 &&
+              mbedtls_ssl_set_session(ssl, &cached) == 0;
+    mbedtls_ssl_session_free(&cached);
+  }
+  xSemaphoreGive(sessionCacheLock());
+  return offered;
+}
+
+/*
+ * Keeps the session of an established connection, or forgets the cached one
+ * if ssl is NULL.
+ */
+static void saveSession(const char *host, mbedtls_ssl_context *ssl) {
+  xSemaphoreTake(sessionCacheLock(), portMAX_DELAY);
+  tlsSessionEntry &entry = getSessionEntry(host);
+  entry.length = 0;
+  if (ssl) {
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    size_t length = 0;
+    int ret = mbedtls_ssl_get_session(ssl, &session);
+    if (ret == 0) {
+      ret = mbedtls_ssl_session_save(&session, entry.data, sizeof(entry.data),
+                                     &length);
+    }
+    if (ret == 0) {
+      entry.length = length;
+    } else if (ret == MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL) {
+      // length is what the session would have needed
+      Serial.printf("TLS session for %s is %u bytes, too big to cache in %u\n",
+                    host, (unsigned)length, (unsigned)TLS_SESSION_MAX_SIZE);
+    } else {
+      Serial.printf("Could not cache TLS session for %s: -0x%04x\n", host,
+                    -ret);
+    }
+    mbedtls_ssl_session_free(&session);
+  }
+  xSemaphoreGive(sessionCacheLock());
+}
+
+int TlsSessionClient::connect(const char *host, uint16_t port) {
+  uint32_t start = millis();
+  if (!handshake(host, port)) {
+    stop();
+    return 0;
+  }
+  Serial.printf("Connected to %s in %lu millis.\n", host, millis() - start);
+  return 1;
+}
+
+/*
+ * As with WiFiClientSecure, timeout bounds the TCP connect and each send and
+ * receive, while the handshake as a whole is bounded by the handshake timeout.
+ */
+int TlsSessionClient::connect(const char *host, uint16_t port,
+                              int32_t timeout) {
+  _timeout = timeout;
+  return connect(host, port);
+}
+
+/*
+ * Sets up sslclient the same way start_ssl_client does, except that the cached
+ * session for the host is handed to mbedtls before the handshake.
+ *
+ * Returns true if the handshake succeeded.
+ */
+bool TlsSessionClient::handshake(const char *host, uint16_t port) {
+  stop();
+  ssl_init(sslclient);
+  _lastError = 0;
+  _peek = -1;
+
+  sslclient->socket = connectSocket(host, port, _timeout);
+  if (sslclient->socket < 0) {
+    _lastError = MBEDTLS_ERR_NET_CONNECT_FAILED;
+    return false;
+  }
+
+  int ret;
+
+  static const char *pers = "esp32-tls";
+  mbedtls_entropy_init(&sslclient->entropy_ctx);
+  if ((ret = mbedtls_ctr_drbg_seed(
+           &sslclient->drbg_ctx, mbedtls_entropy_func, &sslclient->entropy_ctx,
+           (const unsigned char *)pers, strlen(pers))) != 0 ||
+      (ret = mbedtls_ssl_config_defaults(
+           &sslclient->ssl_conf, MBEDTLS_SSL_IS_CLIENT,
+           MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT)) != 0) {
+    _lastError = ret;
+    return false;
+  }
+  mbedtls_ssl_conf_authmode(&sslclient->ssl_conf, MBEDTLS_SSL_VERIFY_NONE);
+  mbedtls_ssl_conf_rng(&sslclient->ssl_conf, mbedtls_ctr_drbg_random,
+                       &sslclient->drbg_ctx);
+  if ((ret = mbedtls_ssl_setup(&sslclient->ssl_ctx, &sslclient->ssl_conf)) !=
+          0 ||
+      (ret = mbedtls_ssl_set_hostname(&sslclient->ssl_ctx, host)) != 0) {
+    _lastError = ret;
+    return false;
+  }
+
+  // Offer the session from the last connection
+  bool offered = loadSession(host, &sslclient->ssl_ctx);
+
+  mbedtls_ssl_set_bio(&sslclient->ssl_ctx, &sslclient->socket, mbedtls_net_send,
+                      mbedtls_net_recv, NULL);
+
+  uint32_t handshakeStart = millis();
+  while ((ret = mbedtls_ssl_handshake(&sslclient->ssl_ctx)) != 0) {
+    if ((ret != MBEDTLS_ERR_SSL_WANT_READ &&
+         ret != MBEDTLS_ERR_SSL_WANT_WRITE) ||
+        millis() - handshakeStart > sslclient->handshake_timeout) {
+      _lastError = ret;
+      saveSession(host, NULL);
+      return false;
+    }
+    vTaskDelay(2);
+  }
+  Serial.printf("TLS handshake with %s took %lu millis (%s).\n", host,
+                millis() - handshakeStart,
+                offered ? "cached session offered" : "full handshake");
+
+  // Keep the session for the next connection, possibly after deep sleep
+  saveSession(host, &sslclient->ssl_ctx);
+
+  _connected = true;
+  return true;
+}
@@ -17,80 +17,192 @@
 
 #include "bus_icons.h"
 #include "client_utils.h"
+#include "config.h"
+#include "display_utils.h"
+#include "fetch_session.h"
 #include "renderer.h"
+#include "rtc_memory.h"
 #include "secrets.h"
 #include "weather_icons.h"
 
+// Also fetch the 3 hourly forecast and draw it below the current conditions
+const bool showForecast = true;
+
+// Height of the current conditions, the forecast is drawn below them
+#define WEATHER_CONDITIONS_HEIGHT (WEATHER_ICON_HEIGHT + 170)
+
+// The last fetched weather, kept across deep sleep so that wakes where the
+// weather isn't due can still draw it
+struct savedWeather {
+    bool valid;
+    bool forecastStale;
+    weatherReport report;
+};
+RTC_DATA_ATTR static savedWeather saved;
+static_assert(sizeof(saved) <= RTC_WEATHER_SHARE,
+              "saved weather outgrows RTC_WEATHER_SHARE");
+
 /*
-Weather::Weather(GxEPD2_GFX& display, Renderer& renderer)
+Weather::Weather(DisplayList& display, Renderer& renderer)
     : _display(display), _renderer(renderer) {}
 */
 
-Weather::Weather(GxEPD2_GFX& display, Renderer& renderer)
-    : _display(display), _renderer(renderer), _renderX(0), _renderY(0), _renderWidth(0), _renderHeight(0) {}
+Weather::Weather(DisplayList& display, Renderer& renderer)
+    : _display(display), _renderer(renderer), _area{},
+      report{}, fetchedReport{}, isStale(false), isForecastStale(false),
+      forecastFailed(false) {}
 
 
+/*
+ * The current conditions are what this app is for, so a forecast that can't
+ * be fetched doesn't fail the fetch. commitData() keeps the last forecast
+ * instead, drawn as stale, or there is none if there never was one.
+ */
 bool Weather::fetchData() {
-    return fetchWeatherData();
+    // Both requests go to the same host, so they share one connection
+    FetchSession session;
+    if (!fetchWeatherData(session)) {
+        return false;
+    }
+    forecastFailed = false;
+    if (!showForecast) {
+        fetchedReport.forecast.numPoints = 0;
+    } else if (!fetchForecast(session)) {
+        forecastFailed = true;
+    }
+    return true;
 }
 
-bool Weather::fetchWeatherData() {
-    WiFiClientSecure client;
-    HTTPClient http;
+void Weather::commitData() {
+    if (forecastFailed) {
+        Serial.println("Keeping the last forecast");
+        fetchedReport.forecast = report.forecast;
+    }
+    isForecastStale = forecastFailed && report.forecast.numPoints > 0;
+    report = fetchedReport;
+    isStale = false;
+    saved.report = report;
+    saved.forecastStale = isForecastStale;
+    saved.valid = true;
+}
 
-    client.setInsecure(); // Ignore SSL certificate validation
+uint32_t Weather::maxAge() {
+    return WEATHER_MAX_AGE;
+}
 
-    String url = "https://api.openweathermap.org/data/2.5/weather?q=Punchbowl,au&units=metric&appid=" + String(OPENWEATHER_API_KEY);
+bool Weather::restoreData(bool stale) {
+    isStale = stale;
+    if (!saved.valid) {
+        return false;
+    }
+    report = saved.report;
+    isForecastStale = saved.forecastStale;
+    return true;
+}
 
-    http.begin(client, url);
-    int httpCode = http.GET();
+bool Weather::fetchWeatherData(FetchSession& session) {
+    char url[160];
+    snprintf(url, sizeof(url),
+             "https://api.openweathermap.org/data/2.5/"
+             "weather?q=Punchbowl,au&units=metric&appid=%s",
+             OPENWEATHER_API_KEY);
 
-    if (httpCode > 0) {
-        String payload = http.getString();
-        //DynamicJsonDocument doc(1024);
-        JsonDocument doc;
-        deserializeJson(doc, payload);
+    int httpCode = session.get(url);
 
-        cityName = doc["name"].as<String>();
-        temperature = doc["main"]["temp"].as<float>();
-        feelsLike = doc["main"]["feels_like"].as<float>();
-        humidity = doc["main"]["humidity"].as<int>();
-        weatherDescription = doc["weather"][0]["description"].as<String>();
-        weatherIconCode = doc["weather"][0]["icon"].as<String>();
-        Serial.printf("Error on HTTP request: %s\n", http.errorToString(httpCode).c_str());
-        http.end();
+    if (httpCode == HTTP_CODE_OK) {
+        uint32_t freeHeapBefore = ESP.getFreeHeap();
+        uint32_t parseStart = millis();
+        ReadBufferingStream bufferedStream(session.getStream(), 256);
+        bufferedStream.setTimeout(HTTPCLIENT_DEFAULT_TCP_TIMEOUT);
+        bool parsed = parseWeather(bufferedStream, fetchedReport);
+        session.end(parsed);
+        if (!parsed) {
+            return false;
+        }
+        Serial.printf("Parsed weather in %lu millis, peak heap used: %d bytes\n",
+                      millis() - parseStart,
+                      (int)freeHeapBefore - (int)ESP.getFreeHeap());
         return true;
     } else {
-        Serial.printf("Error on HTTP request: %s\n", http.errorToString(httpCode).c_str());
-        http.end();
+        Serial.printf("Error on HTTP request (%d): %s\n", httpCode,
+                      session.errorToString(httpCode).c_str());
+        session.end(false);
         return false;
     }
 }
 
-void Weather::setRenderArea(int16_t x, int16_t y, int16_t w, int16_t h) {
-    _renderX = x;
-    _renderY = y;
-    _renderWidth = w;
-    _renderHeight = h;
+bool Weather::fetchForecast(FetchSession& session) {
+    char url[192];
+    snprintf(url, sizeof(url),
+             "https://api.openweathermap.org/data/2.5/"
+             "forecast?q=Punchbowl,au&units=metric&cnt=%d&appid=%s",
+             FORECAST_POINTS, OPENWEATHER_API_KEY);
+
+    int httpCode = session.get(url);
+
+    if (httpCode == HTTP_CODE_OK) {
+        uint32_t freeHeapBefore = ESP.getFreeHeap();
+        uint32_t parseStart = millis();
+        ReadBufferingStream bufferedStream(session.getStream(), 256);
+        bufferedStream.setTimeout(HTTPCLIENT_DEFAULT_TCP_TIMEOUT);
+
+        bool parsed = parseForecast(bufferedStream, fetchedReport.forecast);
+        session.end(parsed);
+        if (!parsed) {
+            return false;
+        }
+        Serial.printf("Parsed %u forecast points in %lu millis, heap used: %d bytes\n",
+                      fetchedReport.forecast.numPoints, millis() - parseStart,
+                      (int)freeHeapBefore - (int)ESP.getFreeHeap());
+        return true;
+    } else {
+        Serial.printf("Error on HTTP request (%d): %s\n", httpCode,
+                      session.errorToString(httpCode).c_str());
+        session.end(false);
+        return false;
+    }
+}
+
+/*
+ * Splits the weather into the current conditions and the forecast below them,
+ * each with a digest of what render() would draw there.
+ */
+size_t Weather::digestRegions(Rect regions[], uint32_t digests[]) {
+    // Temperature is drawn with one decimal place
+    int32_t values[] = {(int32_t)lroundf(report.temperature * 10),
+                        report.humidity};
+    uint32_t hash = fnv1aHash(values, sizeof(values));
+    hash = fnv1aHash(report.cityName, hash);
+    hash = fnv1aHash(report.weatherDescription, hash);
+    hash = fnv1aHash(report.weatherIconCode, hash);
+    hash = fnv1aHash(&isStale, sizeof(isStale), hash);
+    // The city name's ascent reaches a little above the area
+    regions[0] = {_area.x, (int16_t)(_area.y - 8), _area.w,
+                  WEATHER_CONDITIONS_HEIGHT + 8};
+    digests[0] = hash;
+
+    const forecastPoints& forecast = report.forecast;
+    hash = fnv1aHash(&forecast.numPoints, sizeof(forecast.numPoints));
+    hash = fnv1aHash(&isForecastStale, sizeof(isForecastStale), hash);
+    regions[1] = {_area.x, (int16_t)(_area.y + WEATHER_CONDITIONS_HEIGHT),
+                  _area.w, (int16_t)(_area.h - WEATHER_CONDITIONS_HEIGHT)};
+    digests[1] = fnv1aHash(forecast.points,
+                           forecast.numPoints * sizeof(forecastPoint), hash);
+    return 2;
+}
+
+void Weather::setRenderArea(const Rect& area) {
+    _area = area;
 }
 
 void Weather::drawWeatherIcon(int16_t x, int16_t y) {
-    // This is a basic implementation. You'll need to modify this based on your specific weather icons and how you want to display them.
-    const unsigned char* icon = nullptr;
-    
-    // Select the appropriate icon based on the weatherIconCode
-    if (weatherIconCode == "01d" || weatherIconCode == "01n") {
-        icon = epd_bitmap_clear_sky; // You need to define this in weather_icons.h
-    } else if (weatherIconCode == "02d" || weatherIconCode == "02n") {
-        icon = epd_bitmap_few_clouds; // You need to define this in weather_icons.h
-    }
-    // Add more conditions for other weather codes
+    const weatherIconInfo* icon = getWeatherIcon(report.weatherIconCode);
 
     // If an icon was selected, draw it
     if (icon != nullptr) {
-        _display.drawBitmap(x, y, icon, WEATHER_ICON_WIDTH, WEATHER_ICON_HEIGHT, GxEPD_BLACK);
+        _display.drawBitmap(x, y, icon->bitmap, WEATHER_ICON_WIDTH, WEATHER_ICON_HEIGHT, GxEPD_BLACK);
     } else {
-        // If no icon matches, you could draw a default icon or just leave it blank
+        // If no icon matches, leave it blank
         _display.fillRect(x, y, WEATHER_ICON_WIDTH, WEATHER_ICON_HEIGHT, GxEPD_WHITE);
     }
 }
@@ -107,27 +219,108 @@ void Weather::render() { //int16_t x, int16_t y, int16_t w, int16_t h) {
     _display.setFont(&FreeSansBold18pt7b);
 
     // Draw weather icon
-    drawWeatherIcon(_renderX, _renderY);
+    drawWeatherIcon(_area.x, _area.y);
 
     // Draw city name
-    _display.setCursor(_renderX + WEATHER_ICON_WIDTH + 5, _renderY + 20);
-    _display.print(cityName);
+    _display.setCursor(_area.x + WEATHER_ICON_WIDTH + 5, _area.y + 20);
+    _display.print(report.cityName);
 
     // Draw temperature
-    _display.setCursor(_renderX + WEATHER_ICON_WIDTH + 5, _renderY + 50);
-    _display.print(String(temperature, 1));
+    _display.setCursor(_area.x + WEATHER_ICON_WIDTH + 5, _area.y + 50);
+    _display.print(String(report.temperature, 1));
     _display.print("°C");
 
     // Draw weather description
-    _display.setCursor(_renderX, _renderY + WEATHER_ICON_HEIGHT + 100);
-    _display.print(weatherDescription);
+    _display.setCursor(_area.x, _area.y + WEATHER_ICON_HEIGHT + 100);
+    _display.print(report.weatherDescription);
 
     // Draw humidity
-    _display.setCursor(_renderX, _renderY + WEATHER_ICON_HEIGHT + 150);
+    _display.setCursor(_area.x, _area.y + WEATHER_ICON_HEIGHT + 150);
     _display.print("Humidity: ");
-    _display.print(humidity);
+    _display.print(report.humidity);
     _display.print("%");
-    
 
-    // TODO: Add weather icon rendering based on weatherIconCode
+    if (isStale) {
+        _renderer.drawStaleMarker(_area.right(), _area.y + 20, RIGHT);
+    }
+
+    // Draw the forecast in what is left of the region
+    int16_t forecastY = _area.y + WEATHER_CONDITIONS_HEIGHT;
+    drawForecast(_area.x, forecastY, _area.w, _area.bottom() - forecastY);
+}
+
+/*
+ * Draws the forecast temperature as a line across the top two thirds of the
+ * area, with the chance of rain for each point as bars along the bottom.
+ */
+void Weather::drawForecast(int16_t x, int16_t y, int16_t w, int16_t h) {
+    const forecastPoints& forecast = report.forecast;
+    const uint8_t n = forecast.numPoints;
+    const int16_t labelWidth = 40;
+    if (isForecastStale) {
+        // On a line of its own above the plot
+        _renderer.drawStaleMarker(x + w, y + 20, RIGHT);
+        y += 24;
+        h -= 24;
+    }
+    if (n < 2 || w <= labelWidth + n || h < 60) {
+        return;
+    }
+
+    int16_t minTemp = INT16_MAX;
+    int16_t maxTemp = INT16_MIN;
+    for (uint8_t i = 0; i < n; i++) {
+        // Copied out, as a packed member can't be bound to min()'s reference
+        int16_t pointTemperature = forecast.points[i].temperature;
+        minTemp = min(minTemp, pointTemperature);
+        maxTemp = max(maxTemp, pointTemperature);
+    }
+    // Keep a steady forecast from being stretched across the whole height
+    if (maxTemp - minTemp < 40) {
+        int16_t middle = (minTemp + maxTemp) / 2;
+        minTemp = middle - 20;
+        maxTemp = middle + 20;
+    }
+
+    const int16_t plotX = x + labelWidth;
+    const int16_t plotW = w - labelWidth;
+    const int16_t tempH = h * 2 / 3 - 8;
+    const int16_t rainH = h - h * 2 / 3;
+    const int16_t rainBottom = y + h - 1;
+
+    // Temperature range labels in whole degrees, drawn on their baselines
+    char label[8];
+    _display.setFont(&FreeSans9pt7b);
+    snprintf(label, sizeof(label), "%d", (int)lroundf(maxTemp / 10.0f));
+    _renderer.drawString(x, y + 13, label, LEFT);
+    snprintf(label, sizeof(label), "%d", (int)lroundf(minTemp / 10.0f));
+    _renderer.drawString(x, y + tempH, label, LEFT);
+    _renderer.drawString(x, rainBottom, "rain", LEFT);
+
+    // Temperature line, drawn two pixels thick
+    int16_t prevX = 0;
+    int16_t prevY = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        int16_t px = plotX + (int32_t)i * (plotW - 1) / (n - 1);
+        int16_t py = y + (int32_t)(maxTemp - forecast.points[i].temperature) *
+                             (tempH - 2) / (maxTemp - minTemp);
+        if (i > 0) {
+            _display.drawLine(prevX, prevY, px, py, GxEPD_BLACK);
+            _display.drawLine(prevX, prevY + 1, px, py + 1, GxEPD_BLACK);
+        }
+        prevX = px;
+        prevY = py;
+    }
+
+    // Chance of rain bars
+    const int16_t barPitch = plotW / n;
+    const int16_t barWidth = max(1, barPitch - 2);
+    for (uint8_t i = 0; i < n; i++) {
+        int16_t barHeight = (int32_t)forecast.points[i].pop * (rainH - 1) / 100;
+        if (barHeight > 0) {
+            _display.fillRect(plotX + i * barPitch, rainBottom - barHeight,
+                              barWidth, barHeight, GxEPD_BLACK);
+        }
+    }
+    _display.drawFastHLine(plotX, rainBottom, plotW, GxEPD_BLACK);
 }
\ No newline at end of file
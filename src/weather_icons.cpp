@@ -1,14 +1,6 @@
 #include "weather_icons.h"
 
-// Placeholder bitmap data - replace with actual icon data
-const unsigned char epd_bitmap_sunny[] = {
-    0xFF, 0xFF, 0xFF, 0xFF, 0x80, 0x00, 0x00, 0x01, 0xBF, 0xFF, 0xFF, 0xFD,
-    0xA0, 0x00, 0x00, 0x05, 0xAF, 0xFF, 0xFF, 0xF5, 0xA8, 0x00, 0x00, 0x15,
-    0xAA, 0x00, 0x00, 0x55, 0xAA, 0x80, 0x01, 0x55, 0xAA, 0xA0, 0x05, 0x55,
-    0xAA, 0xA8, 0x15, 0x55, 0xAA, 0xAA, 0x55, 0x55, 0xA8, 0x00, 0x00, 0x15,
-    0xA0, 0x00, 0x00, 0x05, 0x80, 0x00, 0x00, 0x01, 0xFF, 0xFF, 0xFF, 0xFF
-};
-
+// 32x32, drawn in black on the white display with the picture left clear
 const unsigned char epd_bitmap_clear_sky[] = {
     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xf0, 0x0f, 0xff,
     0xff, 0xc0, 0x03, 0xff, 0xff, 0x03, 0xc0, 0xff, 0xfe, 0x1f, 0xf8, 0x7f,
@@ -22,76 +14,58 @@ const unsigned char epd_bitmap_clear_sky[] = {
     0xff, 0x03, 0xc0, 0xff, 0xff, 0xc0, 0x03, 0xff, 0xff, 0xf0, 0x0f, 0xff,
     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
 
-const unsigned char epd_bitmap_few_clouds[] = {
-    0xFF, 0xFF, 0xFF, 0xFF, 0x80, 0x00, 0x00, 0x01, 0xBF, 0xFF, 0xFF, 0xFD,
-    0xA0, 0x00, 0x00, 0x05, 0xAF, 0xFF, 0xFF, 0xF5, 0xA8, 0x00, 0x00, 0x15,
-    0xAA, 0x00, 0x00, 0x55, 0xAA, 0x80, 0x01, 0x55, 0xAA, 0xA0, 0x05, 0x55,
-    0xAA, 0xA8, 0x15, 0x55, 0xAA, 0xAA, 0x55, 0x55, 0xA8, 0x00, 0x00, 0x15,
-    0xA0, 0x00, 0x00, 0x05, 0x80, 0x00, 0x00, 0x01, 0xFF, 0xFF, 0xFF, 0xFF
-};
-
-const unsigned char epd_bitmap_partly_cloudy[] = {
-    0xFF, 0xFF, 0xFF, 0xFF, 0x80, 0x00, 0x00, 0x01, 0xBF, 0xFF, 0xFF, 0xFD,
-    0xA0, 0x00, 0x00, 0x05, 0xAF, 0xFF, 0xFF, 0xF5, 0xA8, 0x00, 0x00, 0x15,
-    0xAA, 0x00, 0x00, 0x55, 0xAA, 0x80, 0x01, 0x55, 0xAA, 0xA0, 0x05, 0x55,
-    0xAA, 0xA8, 0x15, 0x55, 0xAA, 0xAA, 0x55, 0x55, 0xA8, 0x00, 0x00, 0x15,
-    0xA0, 0x00, 0x00, 0x05, 0x80, 0x00, 0x00, 0x01, 0xFF, 0xFF, 0xFF, 0xFF
-};
+// drawWeatherIcon() reads a whole 32x32 icon
+static_assert(sizeof(epd_bitmap_clear_sky) == WEATHER_ICON_BYTES, "wrong size");
 
-const unsigned char epd_bitmap_cloudy[] = {
-    0xFF, 0xFF, 0xFF, 0xFF, 0x80, 0x00, 0x00, 0x01, 0xBF, 0xFF, 0xFF, 0xFD,
-    0xA0, 0x00, 0x00, 0x05, 0xAF, 0xFF, 0xFF, 0xF5, 0xA8, 0x00, 0x00, 0x15,
-    0xAA, 0x00, 0x00, 0x55, 0xAA, 0x80, 0x01, 0x55, 0xAA, 0xA0, 0x05, 0x55,
-    0xAA, 0xA8, 0x15, 0x55, 0xAA, 0xAA, 0x55, 0x55, 0xA8, 0x00, 0x00, 0x15,
-    0xA0, 0x00, 0x00, 0x05, 0x80, 0x00, 0x00, 0x01, 0xFF, 0xFF, 0xFF, 0xFF
+// Every documented OpenWeather icon code, day then night for each condition.
+// See https://openweathermap.org/weather-conditions
+// Clear sky is the only 32x32 weather icon so far, so every condition is drawn
+// with it, and the description drawn beside it says what the weather is.
+static constexpr weatherIconInfo weatherIconTable[] = {
+    {epd_bitmap_clear_sky, "clear sky", false},         // 01d
+    {epd_bitmap_clear_sky, "clear sky", true},          // 01n
+    {epd_bitmap_clear_sky, "few clouds", false},        // 02d
+    {epd_bitmap_clear_sky, "few clouds", true},         // 02n
+    {epd_bitmap_clear_sky, "scattered clouds", false},  // 03d
+    {epd_bitmap_clear_sky, "scattered clouds", true},   // 03n
+    {epd_bitmap_clear_sky, "broken clouds", false},     // 04d
+    {epd_bitmap_clear_sky, "broken clouds", true},      // 04n
+    {epd_bitmap_clear_sky, "shower rain", false},       // 09d
+    {epd_bitmap_clear_sky, "shower rain", true},        // 09n
+    {epd_bitmap_clear_sky, "rain", false},              // 10d
+    {epd_bitmap_clear_sky, "rain", true},               // 10n
+    {epd_bitmap_clear_sky, "thunderstorm", false},      // 11d
+    {epd_bitmap_clear_sky, "thunderstorm", true},       // 11n
+    {epd_bitmap_clear_sky, "snow", false},              // 13d
+    {epd_bitmap_clear_sky, "snow", true},               // 13n
+    {epd_bitmap_clear_sky, "mist", false},              // 50d
+    {epd_bitmap_clear_sky, "mist", true},               // 50n
 };
 
-const unsigned char epd_bitmap_rain[] = {
-    0xFF, 0xFF, 0xFF, 0xFF, 0x80, 0x00, 0x00, 0x01, 0xBF, 0xFF, 0xFF, 0xFD,
-    0xA0, 0x00, 0x00, 0x05, 0xAF, 0xFF, 0xFF, 0xF5, 0xA8, 0x00, 0x00, 0x15,
-    0xAA, 0x00, 0x00, 0x55, 0xAA, 0x80, 0x01, 0x55, 0xAA, 0xA0, 0x05, 0x55,
-    0xAA, 0xA8, 0x15, 0x55, 0xAA, 0xAA, 0x55, 0x55, 0xA8, 0x00, 0x00, 0x15,
-    0xA0, 0x00, 0x00, 0x05, 0x80, 0x00, 0x00, 0x01, 0xFF, 0xFF, 0xFF, 0xFF
-};
+// Day entry in weatherIconTable for each two digit code, -1 if not a code
+static constexpr int8_t weatherIconSlots[51] = {
+    -1, 0,  2,  4,  6,  -1, -1, -1, -1, 8,   // 00-09
+    10, 12, -1, 14, -1, -1, -1, -1, -1, -1,  // 10-19
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  // 20-29
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  // 30-39
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  // 40-49
+    16};                                     // 50
 
-const unsigned char epd_bitmap_thunderstorm[] = {
-    0xFF, 0xFF, 0xFF, 0xFF, 0x80, 0x00, 0x00, 0x01, 0xBF, 0xFF, 0xFF, 0xFD,
-    0xA0, 0x00, 0x00, 0x05, 0xAF, 0xFF, 0xFF, 0xF5, 0xA8, 0x00, 0x00, 0x15,
-    0xAA, 0x00, 0x00, 0x55, 0xAA, 0x80, 0x01, 0x55, 0xAA, 0xA0, 0x05, 0x55,
-    0xAA, 0xA8, 0x15, 0x55, 0xAA, 0xAA, 0x55, 0x55, 0xA8, 0x00, 0x00, 0x15,
-    0xA0, 0x00, 0x00, 0x05, 0x80, 0x00, 0x00, 0x01, 0xFF, 0xFF, 0xFF, 0xFF
-};
-
-const unsigned char epd_bitmap_snow[] = {
-    0xFF, 0xFF, 0xFF, 0xFF, 0x80, 0x00, 0x00, 0x01, 0xBF, 0xFF, 0xFF, 0xFD,
-    0xA0, 0x00, 0x00, 0x05, 0xAF, 0xFF, 0xFF, 0xF5, 0xA8, 0x00, 0x00, 0x15,
-    0xAA, 0x00, 0x00, 0x55, 0xAA, 0x80, 0x01, 0x55, 0xAA, 0xA0, 0x05, 0x55,
-    0xAA, 0xA8, 0x15, 0x55, 0xAA, 0xAA, 0x55, 0x55, 0xA8, 0x00, 0x00, 0x15,
-    0xA0, 0x00, 0x00, 0x05, 0x80, 0x00, 0x00, 0x01, 0xFF, 0xFF, 0xFF, 0xFF
-};
-
-const unsigned char epd_bitmap_mist[] = {
-    0xFF, 0xFF, 0xFF, 0xFF, 0x80, 0x00, 0x00, 0x01, 0xBF, 0xFF, 0xFF, 0xFD,
-    0xA0, 0x00, 0x00, 0x05, 0xAF, 0xFF, 0xFF, 0xF5, 0xA8, 0x00, 0x00, 0x15,
-    0xAA, 0x00, 0x00, 0x55, 0xAA, 0x80, 0x01, 0x55, 0xAA, 0xA0, 0x05, 0x55,
-    0xAA, 0xA8, 0x15, 0x55, 0xAA, 0xAA, 0x55, 0x55, 0xA8, 0x00, 0x00, 0x15,
-    0xA0, 0x00, 0x00, 0x05, 0x80, 0x00, 0x00, 0x01, 0xFF, 0xFF, 0xFF, 0xFF
-};
+const weatherIconInfo* getWeatherIcon(const char* iconCode) {
+    if (iconCode[0] < '0' || iconCode[0] > '9' || iconCode[1] < '0' ||
+        iconCode[1] > '9' || (iconCode[2] != 'd' && iconCode[2] != 'n') ||
+        iconCode[3] != '\0') {
+        return nullptr;
+    }
+    int code = (iconCode[0] - '0') * 10 + (iconCode[1] - '0');
+    if (code >= (int)sizeof(weatherIconSlots) || weatherIconSlots[code] < 0) {
+        return nullptr;
+    }
+    return &weatherIconTable[weatherIconSlots[code] + (iconCode[2] == 'n')];
+}
 
-const unsigned char* getWeatherBitmap(const String& iconCode) {
-    //if (iconCode == "01d" || iconCode == "01n") return epd_bitmap_sunny;
-    //if (iconCode == "02d" || iconCode == "02n") return epd_bitmap_partly_cloudy;
-    if (iconCode == "01d" || iconCode == "01n") return epd_bitmap_clear_sky;
-    if (iconCode == "02d" || iconCode == "02n") return epd_bitmap_few_clouds;
-    
-    if (iconCode == "03d" || iconCode == "03n") return epd_bitmap_cloudy;
-    if (iconCode == "04d" || iconCode == "04n") return epd_bitmap_cloudy;
-    if (iconCode == "09d" || iconCode == "09n") return epd_bitmap_rain;
-    if (iconCode == "10d" || iconCode == "10n") return epd_bitmap_rain;
-    if (iconCode == "11d" || iconCode == "11n") return epd_bitmap_thunderstorm;
-    if (iconCode == "13d" || iconCode == "13n") return epd_bitmap_snow;
-    if (iconCode == "50d" || iconCode == "50n") return epd_bitmap_mist;
-    
-    // Default to sunny if no match is found
-    return epd_bitmap_clear_sky;
-}
\ No newline at end of file
+const unsigned char* getWeatherBitmap(const char* iconCode) {
+    const weatherIconInfo* icon = getWeatherIcon(iconCode);
+    // Default to clear sky if no match is found
+    return icon ? icon->bitmap : epd_bitmap_clear_sky;
+}
@@ -0,0 +1,114 @@
+// Decoding of OpenWeather responses.
+
+#include "weather_report.h"
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <math.h>
+
+/*
+ * The filter: it contains "true" for each value we want to keep
+ */
+static JsonDocument buildWeatherFilter() {
+    JsonDocument filter;
+    filter["name"] = true;
+    filter["main"]["temp"] = true;
+    filter["main"]["feels_like"] = true;
+    filter["main"]["humidity"] = true;
+    filter["weather"][0]["description"] = true;
+    filter["weather"][0]["icon"] = true;
+    return filter;
+}
+
+static JsonDocument buildForecastFilter() {
+    JsonDocument filter;
+    filter["dt"] = true;
+    filter["main"]["temp"] = true;
+    filter["pop"] = true;
+    return filter;
+}
+
+/*
+ * Reads the current conditions from a weather response. Only the fields that
+ * are drawn are kept while parsing, and they are copied into the report.
+ *
+ * Returns true if the response was parsed successfully.
+ */
+bool parseWeather(Stream& stream, weatherReport& result) {
+    // Built on first use, then shared by every cycle
+    static const JsonDocument filter = buildWeatherFilter();
+
+    JsonDocument doc;
+    DeserializationError err = deserializeJson(
+        doc, stream,
+        DeserializationOption::Filter(filter.as<JsonVariantConst>()));
+    if (err) {
+        Serial.printf("Error parsing weather response! %s\n", err.c_str());
+        return false;
+    }
+
+    strlcpy(result.cityName, doc["name"] | "", sizeof(result.cityName));
+    result.temperature = doc["main"]["temp"].as<float>();
+    result.feelsLike = doc["main"]["feels_like"].as<float>();
+    result.humidity = doc["main"]["humidity"].as<int>();
+    strlcpy(result.weatherDescription, doc["weather"][0]["description"] | "",
+            sizeof(result.weatherDescription));
+    strlcpy(result.weatherIconCode, doc["weather"][0]["icon"] | "",
+            sizeof(result.weatherIconCode));
+    return true;
+}
+
+/*
+ * Reads a forecast response from the stream one list entry at a time, so only
+ * one entry is ever held as a JsonDocument however many points are returned.
+ * Entries past FORECAST_POINTS are skipped.
+ *
+ * Returns true if the response was parsed successfully.
+ */
+bool parseForecast(Stream& stream, forecastPoints& result) {
+    result.startTime = 0;
+    result.interval = 0;
+    result.numPoints = 0;
+
+    // Built on first use, then shared by every cycle
+    static const JsonDocument filter = buildForecastFilter();
+
+    if (!stream.find("\"list\"") || !stream.find("[")) {
+        Serial.println("Error parsing forecast! No list");
+        return false;
+    }
+    while (stream.peek() == ' ' || stream.peek() == '\n' ||
+           stream.peek() == '\r' || stream.peek() == '\t') {
+        stream.read();
+    }
+    bool hasEntries = stream.peek() != ']';
+    while (hasEntries) {
+        JsonDocument entry;
+        DeserializationError err = deserializeJson(
+            entry, stream,
+            DeserializationOption::Filter(filter.as<JsonVariantConst>()));
+        if (err) {
+            Serial.printf("Error parsing forecast! %s\n", err.c_str());
+            return false;
+        }
+
+        if (result.numPoints < FORECAST_POINTS) {
+            time_t pointTime = entry["dt"].as<time_t>();
+            if (result.numPoints == 0) {
+                result.startTime = pointTime;
+            } else if (result.numPoints == 1) {
+                result.interval = pointTime - result.startTime;
+            }
+
+            float temperature = entry["main"]["temp"].as<float>();
+            float pop = entry["pop"].as<float>();
+            forecastPoint& point = result.points[result.numPoints++];
+            point.temperature =
+                (int16_t)constrain(lroundf(temperature * 10), INT16_MIN, INT16_MAX);
+            point.pop = (uint8_t)constrain(lroundf(pop * 100), 0, 100);
+        }
+
+        hasEntries = stream.findUntil(",", "]");
+    }
+    return true;
+}
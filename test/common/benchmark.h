@@ -0,0 +1,29 @@
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+/*
+ * Benchmarks are built with -DBENCHMARK, as the native_benchmark environment
+ * does, and only print their timings: wall clock times vary too much from
+ * machine to machine to assert on.
+ */
+
+#include <stdio.h>
+
+#include <chrono>
+
+/*
+ * Runs f the given number of times and returns the average time per run in
+ * microseconds.
+ */
+template <typename F>
+double microsPerRun(int runs, F f) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < runs; i++) {
+    f();
+  }
+  std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / runs;
+}
+
+#endif
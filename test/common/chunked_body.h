@@ -0,0 +1,21 @@
+#ifndef __CHUNKED_BODY_H__
+#define __CHUNKED_BODY_H__
+
+#include <stdio.h>
+
+#include <string>
+
+// body with chunked transfer encoding, in chunks of up to chunkSize bytes
+inline std::string chunkedBody(const std::string &body, size_t chunkSize,
+                               const char *trailer = "") {
+  std::string encoded;
+  for (size_t i = 0; i < body.size(); i += chunkSize) {
+    std::string chunk = body.substr(i, chunkSize);
+    char size[16];
+    snprintf(size, sizeof(size), "%zx\r\n", chunk.size());
+    encoded += size + chunk + "\r\n";
+  }
+  return encoded + "0\r\n" + trailer + "\r\n";
+}
+
+#endif
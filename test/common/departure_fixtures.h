@@ -0,0 +1,141 @@
+#ifndef __DEPARTURE_FIXTURES_H__
+#define __DEPARTURE_FIXTURES_H__
+
+/*
+ * departure_mon responses in the shape the TfNSW API returns them, with all of
+ * the fields that the filters throw away, for any number of stop events.
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include <string>
+
+// 2024-06-03T08:00:00Z, the time the fixtures are read at
+#define FIXTURE_NOW ((time_t)1717401600)
+
+struct departureFixture {
+  int numStopEvents;
+  int secondsApart;    // between planned departures
+  int realtimeEvery;   // every nth event has an estimated time, 0 for none
+  int cancelledEvery;  // every nth event is cancelled, 0 for none
+  bool pretty;         // indented, as when the response is logged
+  bool mixedParents;   // events at more than one parent stop
+};
+
+// The defaults are a busy station, such as Central
+inline departureFixture busyStation(int numStopEvents) {
+  return {numStopEvents, 20, 2, 17, false, false};
+}
+
+inline std::string formatTimeUtc(time_t time) {
+  struct tm tm;
+  gmtime_r(&time, &tm);
+  char buffer[24];
+  strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", &tm);
+  return buffer;
+}
+
+inline std::string departureMonResponse(const departureFixture &fixture) {
+  static const char *routes[] = {"T3", "T1", "T8", "M", "440", "L2", "F1"};
+  static const int iconIds[] = {1, 1, 1, 2, 5, 4, 9};
+  static const char *destinations[] = {
+      "City Circle via Museum", "Emu Plains via Central", "Macarthur",
+      "Tallawong", "Bondi Junction", "Randwick", "Manly"};
+  const char *nl = fixture.pretty ? "\n  " : "";
+  const char *sp = fixture.pretty ? " " : "";
+
+  std::string json = "{";
+  json += nl;
+  json += "\"version\":\"10.2.1.42\",\"systemMessages\":[],";
+  json += nl;
+  json +=
+      "\"locations\":[{\"id\":\"200060\",\"name\":\"Central Station, "
+      "Sydney\",\"disassembledName\":\"Central\",\"coord\":[-33.88,"
+      "151.20],\"type\":\"stop\",\"matchQuality\":100000,\"isBest\":true,"
+      "\"parent\":{\"id\":\"95301001\",\"name\":\"Sydney\",\"type\":"
+      "\"locality\"},\"assignedStops\":[{\"id\":\"200060\",\"name\":\"Central "
+      "Station\",\"type\":\"stop\",\"coord\":[-33.88,151.20],\"connectingMode\""
+      ":100,\"productClasses\":[1,2,4,5],\"properties\":{\"stopId\":"
+      "\"10101100\"},\"modes\":[1,2,4,5]}],\"properties\":{\"stopId\":"
+      "\"10101100\"}}],";
+  json += nl;
+  json += "\"stopEvents\":[";
+  for (int i = 0; i < fixture.numStopEvents; i++) {
+    int route = (i * 5 + i / 3) % 7;
+    time_t planned = FIXTURE_NOW + 30 + (time_t)i * fixture.secondsApart;
+    bool realtime = fixture.realtimeEvery && i % fixture.realtimeEvery == 0;
+    // Late enough to overtake the next few planned departures
+    time_t estimated = planned + (i * 37) % 97;
+    bool cancelled =
+        fixture.cancelledEvery && i % fixture.cancelledEvery == 3;
+    const char *parent = fixture.mixedParents && i % 4 == 1
+                             ? "Central Station Light Rail"
+                             : "Central Station";
+    char platform[8];
+    snprintf(platform, sizeof(platform), "%d", 1 + i % 25);
+
+    if (i > 0) {
+      json += ",";
+    }
+    json += nl;
+    json += sp;
+    json += "{\"location\":{\"id\":\"2000";
+    json += platform;
+    json += "\",\"name\":\"Central Station, Platform ";
+    json += platform;
+    json += "\",\"disassembledName\":\"Platform ";
+    json += platform;
+    json +=
+        "\",\"type\":\"platform\",\"coord\":[-33.88,151.20],\"properties\":"
+        "{\"stopId\":\"10101100\",\"area\":\"1\",\"platform\":\"";
+    json += platform;
+    json += "\"},\"parent\":{\"id\":\"200060\",\"name\":\"";
+    json += parent;
+    json += ", Sydney\",\"disassembledName\":\"";
+    json += parent;
+    json +=
+        "\",\"type\":\"stop\",\"parent\":{\"id\":\"95301001\",\"name\":"
+        "\"Sydney\",\"type\":\"locality\"},\"properties\":{\"stopId\":"
+        "\"10101100\"}}},";
+    json += "\"departureTimePlanned\":\"" + formatTimeUtc(planned) + "\",";
+    json += "\"departureTimeBaseTimetable\":\"" + formatTimeUtc(planned) +
+            "\",";
+    if (realtime) {
+      json += "\"departureTimeEstimated\":\"" + formatTimeUtc(estimated) +
+              "\",\"isRealtimeControlled\":true,";
+    }
+    if (cancelled) {
+      json += "\"isCancelled\":true,";
+    }
+    json += "\"transportation\":{\"id\":\"nsw:020";
+    json += routes[route];
+    json += ":\",\"name\":\"Network ";
+    json += routes[route];
+    json += " Line\",\"disassembledName\":\"";
+    json += routes[route];
+    json += "\",\"number\":\"";
+    json += routes[route];
+    json += " Line\",\"iconId\":" + std::to_string(iconIds[route]);
+    json +=
+        ",\"description\":\"Central to the suburbs\",\"product\":{\"class\":" +
+        std::to_string(iconIds[route]) + ",\"name\":\"Network\",\"iconId\":" +
+        std::to_string(iconIds[route]) +
+        "},\"operator\":{\"id\":\"x0001\",\"name\":\"Operator\"},"
+        "\"destination\":{\"id\":\"10101331\",\"name\":\"";
+    json += destinations[route];
+    json +=
+        "\",\"type\":\"stop\"},\"properties\":{\"tripCode\":" +
+        std::to_string(1000 + i) +
+        ",\"isTTB\":true,\"timetablePeriod\":\"Timetable 2024\"},\"origin\":"
+        "{\"id\":\"10101252\",\"name\":\"Origin Station\",\"type\":\"stop\"}},"
+        "\"hints\":[{\"infoType\":\"stopBlocking\",\"content\":\"Not all "
+        "services stop at every station\"}],\"properties\":{"
+        "\"WheelchairAccess\":\"true\",\"RealtimeTripId\":\"" +
+        std::to_string(58000 + i) + "\"}}";
+  }
+  json += fixture.pretty ? "\n  ]\n}\n" : "]}";
+  return json;
+}
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef __FIXTURE_STREAM_H__
+#define __FIXTURE_STREAM_H__
+
+#include <Arduino.h>
+#include <Client.h>
+
+#include <string>
+
+/*
+ * Serves a recorded response as the Client it would arrive on. With a burst
+ * size set, the data arrives that many bytes at a time and read() finds
+ * nothing in between, the way a network connection stalls while it waits for
+ * the next packet. peek() never stalls.
+ */
+class FixtureStream : public Client {
+ public:
+  FixtureStream(const std::string &data, size_t burst = 0)
+      : _data(data),
+        _position(0),
+        _burst(burst),
+        _untilStall(burst),
+        _numReads(0) {}
+
+  int available() override {
+    if (stalled()) {
+      return 0;
+    }
+    size_t left = _data.size() - _position;
+    return _burst != 0 && _untilStall < left ? _untilStall : left;
+  }
+
+  int read() override {
+    _numReads++;
+    if (stalled()) {
+      // The next packet arrives after this read
+      _untilStall = _burst;
+      return -1;
+    }
+    if (_position == _data.size()) {
+      return -1;
+    }
+    if (_burst != 0) {
+      _untilStall--;
+    }
+    return (uint8_t)_data[_position++];
+  }
+
+  int read(uint8_t *buffer, size_t size) override {
+    _numReads++;
+    int n = available();
+    if (n == 0) {
+      if (stalled()) {
+        _untilStall = _burst;
+      }
+      return -1;
+    }
+    if ((size_t)n > size) {
+      n = size;
+    }
+    memcpy(buffer, _data.data() + _position, n);
+    _position += n;
+    if (_burst != 0) {
+      _untilStall -= n;
+    }
+    return n;
+  }
+
+  int peek() override {
+    return _position < _data.size() ? (uint8_t)_data[_position] : -1;
+  }
+
+  size_t write(uint8_t) override { return 0; }
+
+  size_t position() const { return _position; }
+  // Calls to either read(), each of which costs a TLS record read on a device
+  size_t numReads() const { return _numReads; }
+
+ private:
+  const std::string &_data;
+  size_t _position;
+  size_t _burst;
+  size_t _untilStall;
+  size_t _numReads;
+
+  bool stalled() const { return _burst != 0 && _untilStall == 0; }
+};
+
+#endif
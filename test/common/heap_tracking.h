@@ -0,0 +1,83 @@
+#ifndef __HEAP_TRACKING_H__
+#define __HEAP_TRACKING_H__
+
+/*
+ * Counts the heap in use by replacing malloc and friends, so a test can find
+ * the most heap a piece of code needed at once. Include it from one file of a
+ * test only. Needs glibc, elsewhere heapTrackingAvailable() is false.
+ */
+
+#include <stddef.h>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+}
+
+static long heapInUse = 0;
+static long heapPeak = 0;
+
+static void heapAdded(void *ptr) {
+  if (ptr != NULL) {
+    heapInUse += malloc_usable_size(ptr);
+    if (heapInUse > heapPeak) {
+      heapPeak = heapInUse;
+    }
+  }
+}
+
+extern "C" void *malloc(size_t size) {
+  void *ptr = __libc_malloc(size);
+  heapAdded(ptr);
+  return ptr;
+}
+
+extern "C" void *calloc(size_t count, size_t size) {
+  void *ptr = __libc_calloc(count, size);
+  heapAdded(ptr);
+  return ptr;
+}
+
+extern "C" void *realloc(void *ptr, size_t size) {
+  size_t oldSize = ptr != NULL ? malloc_usable_size(ptr) : 0;
+  void *newPtr = __libc_realloc(ptr, size);
+  if (newPtr != NULL || size == 0) {
+    heapInUse -= oldSize;
+    heapAdded(newPtr);
+  }
+  return newPtr;
+}
+
+extern "C" void free(void *ptr) {
+  if (ptr != NULL) {
+    heapInUse -= malloc_usable_size(ptr);
+  }
+  __libc_free(ptr);
+}
+
+inline bool heapTrackingAvailable() { return true; }
+#else
+static long heapInUse = 0;
+static long heapPeak = 0;
+
+inline bool heapTrackingAvailable() { return false; }
+#endif
+
+/*
+ * Runs f and returns the most heap it had allocated at once, on top of what
+ * was allocated before.
+ */
+template <typename F>
+long peakHeapUsed(F f) {
+  long before = heapInUse;
+  heapPeak = heapInUse;
+  f();
+  return heapPeak - before;
+}
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef __WEATHER_FIXTURES_H__
+#define __WEATHER_FIXTURES_H__
+
+/*
+ * OpenWeather responses in the shape the API returns them, with all of the
+ * fields that the filters throw away.
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include <string>
+
+// A current weather response, for the given description
+inline std::string currentWeatherResponse(
+    const char *description = "light rain") {
+  return std::string(
+             "{\"coord\":{\"lon\":151.05,\"lat\":-33.9333},\"weather\":[{"
+             "\"id\":500,\"main\":\"Rain\",\"description\":\"") +
+         description +
+         "\",\"icon\":\"10d\"}],\"base\":\"stations\",\"main\":{\"temp\":18."
+         "52,\"feels_like\":18.1,\"temp_min\":17.24,\"temp_max\":19.68,"
+         "\"pressure\":1014,\"humidity\":71,\"sea_level\":1014,\"grnd_level\":"
+         "1009},\"visibility\":10000,\"wind\":{\"speed\":5.66,\"deg\":170,"
+         "\"gust\":8.23},\"rain\":{\"1h\":0.31},\"clouds\":{\"all\":75},\"dt\":"
+         "1717401600,\"sys\":{\"type\":2,\"id\":2002865,\"country\":\"AU\","
+         "\"sunrise\":1717361927,\"sunset\":1717397751},\"timezone\":36000,"
+         "\"id\":2153391,\"name\":\"Punchbowl\",\"cod\":200}";
+}
+
+// The first forecast step, 2024-06-03T09:00:00Z
+#define FORECAST_START ((time_t)1717405200)
+#define FORECAST_INTERVAL 10800
+
+// Temperature of forecast step i, in tenths of a degree, some below zero
+inline int forecastTenths(int i) { return (i * 37) % 301 - 40; }
+
+// Chance of rain of forecast step i, in percent
+inline int forecastPop(int i) { return (i * 29) % 101; }
+
+/*
+ * A 3 hourly forecast response with numEntries steps, the way the forecast
+ * endpoint returns them without cnt. Indented when pretty, as when logged.
+ */
+inline std::string forecastResponse(int numEntries, bool pretty = false) {
+  const char *nl = pretty ? "\n    " : "";
+  std::string json = pretty ? "{\n  " : "{";
+  json += "\"cod\":\"200\",\"message\":0,\"cnt\":" +
+          std::to_string(numEntries) + ",";
+  json += pretty ? "\n  \"list\": [" : "\"list\":[";
+  for (int i = 0; i < numEntries; i++) {
+    time_t dt = FORECAST_START + (time_t)i * FORECAST_INTERVAL;
+    struct tm tm;
+    gmtime_r(&dt, &tm);
+    char dtText[24];
+    strftime(dtText, sizeof(dtText), "%Y-%m-%d %H:%M:%S", &tm);
+    // Off the tenth by a little, as the API's two decimals are
+    char temp[16];
+    snprintf(temp, sizeof(temp), "%.2f",
+             forecastTenths(i) / 10.0 + (forecastTenths(i) < 0 ? -0.02 : 0.02));
+    char pop[16];
+    snprintf(pop, sizeof(pop), "%.2f", forecastPop(i) / 100.0);
+
+    if (i > 0) {
+      json += ",";
+    }
+    json += nl;
+    json += "{\"dt\":" + std::to_string((long long)dt) +
+            ",\"main\":{\"temp\":" + temp + ",\"feels_like\":" + temp +
+            ",\"temp_min\":" + temp + ",\"temp_max\":" + temp +
+            ",\"pressure\":1014,\"sea_level\":1014,\"grnd_level\":1009,"
+            "\"humidity\":71,\"temp_kf\":0},\"weather\":[{\"id\":500,\"main\":"
+            "\"Rain\",\"description\":\"light rain\",\"icon\":\"10d\"}],"
+            "\"clouds\":{\"all\":75},\"wind\":{\"speed\":5.66,\"deg\":170,"
+            "\"gust\":8.23},\"visibility\":10000,\"pop\":" +
+            pop + ",\"rain\":{\"3h\":0.31},\"sys\":{\"pod\":\"d\"},"
+            "\"dt_txt\":\"" + dtText + "\"}";
+  }
+  json += pretty ? "\n  ],\n  " : "],";
+  json +=
+      "\"city\":{\"id\":2153391,\"name\":\"Punchbowl\",\"coord\":{\"lat\":"
+      "-33.9333,\"lon\":151.05},\"country\":\"AU\",\"population\":19206,"
+      "\"timezone\":36000,\"sunrise\":1717361927,\"sunset\":1717397751}";
+  json += pretty ? "\n}" : "}";
+  return json;
+}
+
+#endif
@@ -0,0 +1,197 @@
+#ifndef __ADAFRUIT_GFX_STUB_H__
+#define __ADAFRUIT_GFX_STUB_H__
+
+/*
+ * Just enough of Adafruit_GFX for the drawing code built for the host tests.
+ * The primitives are the library's own: every shape ends up as drawPixel()
+ * calls unless a subclass overrides it, and lines are the same Bresenham
+ * walk, so pixels match what the board draws. Text is not drawn.
+ */
+
+#include <Arduino.h>
+
+#include <utility>
+
+class Adafruit_GFX : public Print {
+ public:
+  Adafruit_GFX(int16_t w, int16_t h)
+      : WIDTH(w),
+        HEIGHT(h),
+        _width(w),
+        _height(h),
+        rotation(0),
+        wrap(true) {}
+
+  virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+  virtual void startWrite() {}
+  virtual void writePixel(int16_t x, int16_t y, uint16_t color) {
+    drawPixel(x, y, color);
+  }
+  virtual void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                             uint16_t color) {
+    fillRect(x, y, w, h, color);
+  }
+  virtual void writeFastVLine(int16_t x, int16_t y, int16_t h,
+                              uint16_t color) {
+    drawFastVLine(x, y, h, color);
+  }
+  virtual void writeFastHLine(int16_t x, int16_t y, int16_t w,
+                              uint16_t color) {
+    drawFastHLine(x, y, w, color);
+  }
+  virtual void writeLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                         uint16_t color) {
+    bool steep = abs(y1 - y0) > abs(x1 - x0);
+    if (steep) {
+      std::swap(x0, y0);
+      std::swap(x1, y1);
+    }
+    if (x0 > x1) {
+      std::swap(x0, x1);
+      std::swap(y0, y1);
+    }
+    int16_t dx = x1 - x0;
+    int16_t dy = abs(y1 - y0);
+    int16_t err = dx / 2;
+    int16_t ystep = y0 < y1 ? 1 : -1;
+    for (; x0 <= x1; x0++) {
+      if (steep) {
+        writePixel(y0, x0, color);
+      } else {
+        writePixel(x0, y0, color);
+      }
+      err -= dy;
+      if (err < 0) {
+        y0 += ystep;
+        err += dx;
+      }
+    }
+  }
+  virtual void endWrite() {}
+
+  virtual void drawFastVLine(int16_t x, int16_t y, int16_t h,
+                             uint16_t color) {
+    startWrite();
+    writeLine(x, y, x, y + h - 1, color);
+    endWrite();
+  }
+  virtual void drawFastHLine(int16_t x, int16_t y, int16_t w,
+                             uint16_t color) {
+    startWrite();
+    writeLine(x, y, x + w - 1, y, color);
+    endWrite();
+  }
+  virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                        uint16_t color) {
+    startWrite();
+    for (int16_t i = x; i < x + w; i++) {
+      writeFastVLine(i, y, h, color);
+    }
+    endWrite();
+  }
+  virtual void fillScreen(uint16_t color) {
+    fillRect(0, 0, _width, _height, color);
+  }
+  virtual void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                        uint16_t color) {
+    if (x0 == x1) {
+      if (y0 > y1) {
+        std::swap(y0, y1);
+      }
+      drawFastVLine(x0, y0, y1 - y0 + 1, color);
+    } else if (y0 == y1) {
+      if (x0 > x1) {
+        std::swap(x0, x1);
+      }
+      drawFastHLine(x0, y0, x1 - x0 + 1, color);
+    } else {
+      startWrite();
+      writeLine(x0, y0, x1, y1, color);
+      endWrite();
+    }
+  }
+  virtual void setRotation(uint8_t r) {
+    rotation = r & 3;
+    _width = rotation & 1 ? HEIGHT : WIDTH;
+    _height = rotation & 1 ? WIDTH : HEIGHT;
+  }
+
+  void drawBitmap(int16_t x, int16_t y, const uint8_t bitmap[], int16_t w,
+                  int16_t h, uint16_t color) {
+    int16_t byteWidth = (w + 7) / 8;
+    uint8_t b = 0;
+    startWrite();
+    for (int16_t j = 0; j < h; j++, y++) {
+      for (int16_t i = 0; i < w; i++) {
+        b = i & 7 ? b << 1 : bitmap[j * byteWidth + i / 8];
+        if (b & 0x80) {
+          writePixel(x + i, y, color);
+        }
+      }
+    }
+    endWrite();
+  }
+
+  size_t write(uint8_t) override { return 1; }
+  using Print::write;
+
+  void setTextWrap(bool w) { wrap = w; }
+  bool getTextWrap() const { return wrap; }
+  int16_t width() const { return _width; }
+  int16_t height() const { return _height; }
+  uint8_t getRotation() const { return rotation; }
+
+ protected:
+  const int16_t WIDTH;
+  const int16_t HEIGHT;
+  int16_t _width;
+  int16_t _height;
+  uint8_t rotation;
+  bool wrap;
+};
+
+// A 1 bit canvas, with a set bit for each pixel drawn in a non-zero color
+class GFXcanvas1 : public Adafruit_GFX {
+ public:
+  GFXcanvas1(uint16_t w, uint16_t h)
+      : Adafruit_GFX(w, h),
+        buffer((uint8_t *)calloc((size_t)(w + 7) / 8 * h, 1)) {}
+  ~GFXcanvas1() { free(buffer); }
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+    if (x < 0 || y < 0 || x >= _width || y >= _height) {
+      return;
+    }
+    int16_t t;
+    switch (rotation) {
+      case 1:
+        t = x;
+        x = WIDTH - 1 - y;
+        y = t;
+        break;
+      case 2:
+        x = WIDTH - 1 - x;
+        y = HEIGHT - 1 - y;
+        break;
+      case 3:
+        t = x;
+        x = y;
+        y = HEIGHT - 1 - t;
+        break;
+    }
+    uint8_t *ptr = &buffer[x / 8 + y * ((WIDTH + 7) / 8)];
+    if (color) {
+      *ptr |= 0x80 >> (x & 7);
+    } else {
+      *ptr &= ~(0x80 >> (x & 7));
+    }
+  }
+
+  uint8_t *getBuffer() const { return buffer; }
+
+ private:
+  uint8_t *buffer;
+};
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef __ARDUINO_STUB_H__
+#define __ARDUINO_STUB_H__
+
+/*
+ * Just enough of the Arduino core for the sources built for the host tests.
+ * Stream waits for data the way the ESP32 core's does: readBytes(), find()
+ * and findUntil() keep reading until the timeout, read() and peek() don't.
+ */
+
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+#include <thread>
+
+inline unsigned long millis() {
+  static const auto start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+inline void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+#define constrain(amt, low, high) \
+  ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+inline size_t strlcpy(char *dst, const char *src, size_t size) {
+  size_t length = strlen(src);
+  if (size > 0) {
+    size_t n = length < size - 1 ? length : size - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+  return length;
+}
+#endif
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size) {
+    size_t n = 0;
+    while (n < size && write(buffer[n])) {
+      n++;
+    }
+    return n;
+  }
+  virtual void flush() {}
+
+  size_t print(const char *s) {
+    size_t n = 0;
+    while (*s) {
+      n += write((uint8_t)*s++);
+    }
+    return n;
+  }
+  size_t println(const char *s) { return print(s) + print("\n"); }
+  size_t printf(const char *format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    return length > 0 ? print(buffer) : 0;
+  }
+};
+
+class HardwareSerial : public Print {
+ public:
+  size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+};
+
+static HardwareSerial Serial;
+
+class Stream : public Print {
+ public:
+  Stream() : _timeout(1000) {}
+
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout) { _timeout = timeout; }
+  unsigned long getTimeout() const { return _timeout; }
+
+  bool find(const char *target) { return findUntil(target, NULL); }
+
+  // Reads up to and including target, or returns false once terminator or
+  // the end of the stream is read first
+  bool findUntil(const char *target, const char *terminator) {
+    size_t targetMatched = 0;
+    size_t terminatorMatched = 0;
+    int c;
+    while ((c = timedRead()) >= 0) {
+      targetMatched = advance(target, targetMatched, c);
+      if (target[targetMatched] == '\0') {
+        return true;
+      }
+      if (terminator != NULL) {
+        terminatorMatched = advance(terminator, terminatorMatched, c);
+        if (terminator[terminatorMatched] == '\0') {
+          return false;
+        }
+      }
+    }
+    return false;
+  }
+
+  virtual size_t readBytes(char *buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+      int c = timedRead();
+      if (c < 0) {
+        break;
+      }
+      buffer[count++] = (char)c;
+    }
+    return count;
+  }
+  virtual size_t readBytes(uint8_t *buffer, size_t length) {
+    return readBytes((char *)buffer, length);
+  }
+
+ protected:
+  unsigned long _timeout;
+
+  int timedRead() {
+    unsigned long start = millis();
+    do {
+      int c = read();
+      if (c >= 0) {
+        return c;
+      }
+    } while (millis() - start < _timeout);
+    return -1;
+  }
+
+ private:
+  // The length of the longest start of s that ends the text matched so far
+  // followed by c
+  static size_t advance(const char *s, size_t matched, int c) {
+    while (true) {
+      if ((uint8_t)s[matched] == c) {
+        return matched + 1;
+      }
+      if (matched == 0) {
+        return 0;
+      }
+      size_t shorter = matched - 1;
+      while (shorter > 0 &&
+             strncmp(s, s + matched - shorter, shorter) != 0) {
+        shorter--;
+      }
+      matched = shorter;
+    }
+  }
+};
+
+#endif
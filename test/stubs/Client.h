@@ -0,0 +1,15 @@
+#ifndef __CLIENT_STUB_H__
+#define __CLIENT_STUB_H__
+
+// The reads of the Arduino core's Client, without the connection management
+
+#include "Arduino.h"
+
+class Client : public Stream {
+ public:
+  using Stream::read;
+  // Reads up to size bytes that have already arrived, -1 if none have
+  virtual int read(uint8_t *buffer, size_t size) = 0;
+};
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef __GXEPD2_STUB_H__
+#define __GXEPD2_STUB_H__
+
+// The colors of GxEPD2, for drawing code built for the host tests
+#define GxEPD_BLACK 0x0000
+#define GxEPD_WHITE 0xFFFF
+
+#endif
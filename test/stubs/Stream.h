@@ -0,0 +1,2 @@
+// Some libraries include Stream on its own rather than through Arduino.h
+#include "Arduino.h"
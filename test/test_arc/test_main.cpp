@@ -0,0 +1,257 @@
+// fillArc() and the status bar icon sprites against the atan2() drawArc() and
+// the icons drawn straight onto the display as they were before.
+
+#include <Adafruit_GFX.h>
+#include <GxEPD2.h>
+#include <math.h>
+#include <unity.h>
+
+#include <vector>
+
+#include "arc.h"
+#include "benchmark.h"
+#include "display_utils.h"
+#include "status_icons.h"
+
+// The old code: the angle of every pixel of the bounding square, in doubles
+static bool isAngleInArc(double angle, double startAngle, double endAngle) {
+  if (startAngle > endAngle) {
+    return angle > startAngle || angle < endAngle;
+  }
+  return angle > startAngle && angle < endAngle;
+}
+
+static void drawArc(Adafruit_GFX &gfx, int16_t cx, int16_t cy,
+                    double startAngle, double endAngle, int16_t innerRadius,
+                    int16_t outerRadius) {
+  for (int16_t y = -outerRadius; y <= outerRadius; y++) {
+    for (int16_t x = -outerRadius; x <= outerRadius; x++) {
+      int32_t distSquared = x * x + y * y;
+      double angle = atan2(-y, x);
+      if (distSquared <= outerRadius * outerRadius &&
+          distSquared > innerRadius * innerRadius &&
+          isAngleInArc(angle, startAngle, endAngle)) {
+        gfx.drawPixel(cx + x, cy + y, GxEPD_BLACK);
+      }
+    }
+  }
+}
+
+static void drawBatteryDirect(Adafruit_GFX &gfx, int16_t x, int16_t y,
+                              int16_t w, int16_t h, uint32_t batPercent) {
+  int16_t strokeWidth = 2;
+  int16_t xIndent = w / 24;
+  int16_t yIndent = h / 4;
+  int16_t batteryThickness = h - 2 * yIndent;
+  int16_t bumpIndent = batteryThickness / 4;
+  int16_t bumpWidth = batteryThickness - 2 * bumpIndent;
+  int16_t bumpLength = w / 8;
+  int16_t batteryLength = w - bumpLength - 2 * xIndent;
+  gfx.fillRect(x + xIndent, y + yIndent, batteryLength, batteryThickness,
+               GxEPD_BLACK);
+  int16_t emptyLength =
+      ceil(((batteryLength - 2 * strokeWidth) * (100 - batPercent)) / 100.0);
+  gfx.fillRect(x + xIndent + batteryLength - strokeWidth - emptyLength,
+               y + yIndent + strokeWidth, emptyLength,
+               batteryThickness - 2 * strokeWidth, GxEPD_WHITE);
+  gfx.fillRect(x + xIndent + batteryLength, y + yIndent + bumpIndent,
+               bumpLength, bumpWidth, GxEPD_BLACK);
+}
+
+static void drawWifiDirect(Adafruit_GFX &gfx, int16_t x, int16_t y, int16_t w,
+                           int16_t h, int rssi) {
+  int16_t xIndent = w / 12;
+  int16_t yIndent = h / 8;
+  int16_t cx = x + w / 2;
+  int16_t cy = y + h - yIndent;
+  double startAngle = atan2(h - 3 * yIndent, w / 2 - xIndent);
+  double endAngle = atan2(h - 3 * yIndent, xIndent - w / 2);
+  int16_t radius = ceil(hypot(w / 2 - xIndent, h - 3 * yIndent));
+  int16_t wifiRadius = ceil(radius * getWifiFrac(rssi));
+  drawArc(gfx, cx, cy, startAngle, endAngle, radius - 1, radius + 1);
+  gfx.drawLine(cx, cy, x + xIndent, y + 2 * yIndent, GxEPD_BLACK);
+  gfx.drawLine(cx, cy - 1, x + xIndent + 1, y + 2 * yIndent, GxEPD_BLACK);
+  gfx.drawLine(cx, cy, x + w - xIndent, y + 2 * yIndent, GxEPD_BLACK);
+  gfx.drawLine(cx, cy - 1, x + w - xIndent - 1, y + 2 * yIndent, GxEPD_BLACK);
+  drawArc(gfx, cx, cy, startAngle, endAngle, 0, wifiRadius);
+}
+
+// As GxEPD2 draws it, the pixels whose bits are clear
+static void drawInvertedBitmap(Adafruit_GFX &gfx, int16_t x, int16_t y,
+                               const uint8_t bitmap[], int16_t w, int16_t h,
+                               uint16_t color) {
+  int16_t byteWidth = (w + 7) / 8;
+  for (int16_t j = 0; j < h; j++) {
+    for (int16_t i = 0; i < w; i++) {
+      if (!(bitmap[j * byteWidth + i / 8] & (0x80 >> (i & 7)))) {
+        gfx.drawPixel(x + i, y + j, color);
+      }
+    }
+  }
+}
+
+// Renderer::drawSprite() without the cache
+static void drawSprite(Adafruit_GFX &gfx, drawIcon_t draw, int16_t level,
+                       int16_t x, int16_t y) {
+  uint8_t bitmap[STATUS_ICON_BYTES];
+  drawIconSprite(bitmap, draw, level);
+  drawInvertedBitmap(gfx, x, y, bitmap, STATUS_ICON_SIZE, STATUS_ICON_SIZE,
+                     GxEPD_BLACK);
+}
+
+// A white canvas, as a page of the display starts
+struct page {
+  GFXcanvas1 canvas;
+  size_t size;
+
+  page(int16_t w, int16_t h) : canvas(w, h), size((size_t)(w + 7) / 8 * h) {
+    canvas.fillScreen(GxEPD_WHITE);
+  }
+  bool operator==(const page &other) const {
+    return memcmp(canvas.getBuffer(), other.canvas.getBuffer(), size) == 0;
+  }
+};
+
+/*
+ * Every combination of start and end direction around the compass, including
+ * the axes, the same direction and half and more than half a turn, for rings
+ * and sectors of a few sizes.
+ */
+void test_fill_arc_matches_atan2() {
+  std::vector<int16_t> components = {-7, -4, -1, 0, 2, 5, 7};
+  int numCases = 0;
+  for (int16_t startX : components) {
+    for (int16_t startY : components) {
+      for (int16_t endX : components) {
+        for (int16_t endY : components) {
+          if ((startX == 0 && startY == 0) || (endX == 0 && endY == 0)) {
+            continue;
+          }
+          for (int16_t outer : {1, 5, 9, 20}) {
+            for (int16_t inner : {0, outer / 2, outer - 1}) {
+              page expected(48, 48);
+              page actual(48, 48);
+              drawArc(expected.canvas, 23, 24, atan2(startY, startX),
+                      atan2(endY, endX), inner, outer);
+              fillArc(actual.canvas, 23, 24, startX, startY, endX, endY,
+                      inner, outer, GxEPD_BLACK);
+              char message[80];
+              snprintf(message, sizeof(message),
+                       "from %d,%d to %d,%d, radii %d to %d", startX, startY,
+                       endX, endY, inner, outer);
+              TEST_ASSERT_TRUE_MESSAGE(expected == actual, message);
+              numCases++;
+            }
+          }
+        }
+      }
+    }
+  }
+  printf("%d arcs drawn the same\n", numCases);
+}
+
+void test_fill_arc_clips_to_the_display() {
+  page expected(16, 16);
+  page actual(16, 16);
+  drawArc(expected.canvas, 2, 14, atan2(3, 10), atan2(3, -10), 3, 12);
+  fillArc(actual.canvas, 2, 14, 10, 3, -10, 3, 3, 12, GxEPD_BLACK);
+  TEST_ASSERT_TRUE(expected == actual);
+}
+
+/*
+ * Each icon blitted from its sprite matches the icon drawn straight onto the
+ * page, at every charge and signal strength, and at x positions that do and
+ * don't fall on a byte.
+ */
+void test_sprites_match_direct_drawing() {
+  for (int16_t x : {0, 8, 13}) {
+    for (uint32_t batPercent = 0; batPercent <= 100; batPercent++) {
+      page expected(40, 24);
+      page actual(40, 24);
+      drawBatteryDirect(expected.canvas, x, 3, STATUS_ICON_SIZE,
+                        STATUS_ICON_SIZE, batPercent);
+      drawSprite(actual.canvas, drawBattery,
+                 batteryLevel(STATUS_ICON_SIZE, batPercent), x, 3);
+      TEST_ASSERT_TRUE(expected == actual);
+    }
+    for (int rssi : {0, -30, -50, -51, -60, -61, -70, -71, -90}) {
+      page expected(40, 24);
+      page actual(40, 24);
+      drawWifiDirect(expected.canvas, x, 3, STATUS_ICON_SIZE, STATUS_ICON_SIZE,
+                     rssi);
+      drawSprite(actual.canvas, drawWifi,
+                 wifiLevel(STATUS_ICON_SIZE, STATUS_ICON_SIZE, rssi), x, 3);
+      TEST_ASSERT_TRUE(expected == actual);
+    }
+  }
+}
+
+#ifdef BENCHMARK
+/*
+ * Time to draw an arc with atan2() per pixel against spans, and the two
+ * status bar icons drawn directly, from spans into a sprite, and blitted from
+ * a sprite that is already drawn.
+ */
+void test_benchmark_against_atan2() {
+  for (int16_t radius : {9, 20, 60}) {
+    page target(128, 128);
+    const int runs = 2000;
+    double atan2Micros = microsPerRun(runs, [&]() {
+      drawArc(target.canvas, 64, 64, 0.6, 2.5, radius - 2, radius);
+      drawArc(target.canvas, 64, 64, 0.6, 2.5, 0, radius * 3 / 5);
+    });
+    double spanMicros = microsPerRun(runs, [&]() {
+      fillArc(target.canvas, 64, 64, 5, 4, -5, 4, radius - 2, radius,
+              GxEPD_BLACK);
+      fillArc(target.canvas, 64, 64, 5, 4, -5, 4, 0, radius * 3 / 5,
+              GxEPD_BLACK);
+    });
+    printf("radius %2d ring and sector: atan2 %7.2f us, spans %7.2f us\n",
+           radius, atan2Micros, spanMicros);
+  }
+
+  page target(64, 24);
+  const int runs = 20000;
+  int i = 0;
+  double directMicros = microsPerRun(runs, [&]() {
+    drawWifiDirect(target.canvas, 4, 3, STATUS_ICON_SIZE, STATUS_ICON_SIZE,
+                   -55 - (i & 15));
+    drawBatteryDirect(target.canvas, 30, 3, STATUS_ICON_SIZE,
+                      STATUS_ICON_SIZE, i++ % 101);
+  });
+  double spriteMicros = microsPerRun(runs, [&]() {
+    drawSprite(target.canvas, drawWifi,
+               wifiLevel(STATUS_ICON_SIZE, STATUS_ICON_SIZE, -55 - (i & 15)),
+               4, 3);
+    drawSprite(target.canvas, drawBattery,
+               batteryLevel(STATUS_ICON_SIZE, i++ % 101), 30, 3);
+  });
+  uint8_t wifi[STATUS_ICON_BYTES];
+  uint8_t battery[STATUS_ICON_BYTES];
+  drawIconSprite(wifi, drawWifi, 7);
+  drawIconSprite(battery, drawBattery, 5);
+  double cachedMicros = microsPerRun(runs, [&]() {
+    drawInvertedBitmap(target.canvas, 4, 3, wifi, STATUS_ICON_SIZE,
+                       STATUS_ICON_SIZE, GxEPD_BLACK);
+    drawInvertedBitmap(target.canvas, 30, 3, battery, STATUS_ICON_SIZE,
+                       STATUS_ICON_SIZE, GxEPD_BLACK);
+  });
+  printf("status bar icons: direct with atan2 %5.2f us, drawn into sprites "
+         "%5.2f us, cached sprites %5.2f us\n",
+         directMicros, spriteMicros, cachedMicros);
+}
+#endif
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_fill_arc_matches_atan2);
+  RUN_TEST(test_fill_arc_clips_to_the_display);
+  RUN_TEST(test_sprites_match_direct_drawing);
+#ifdef BENCHMARK
+  RUN_TEST(test_benchmark_against_atan2);
+#endif
+  return UNITY_END();
+}
@@ -0,0 +1,150 @@
+// Departure parsing through the read buffer that Bus::fetchForStopId puts in
+// front of the response body, on recorded responses.
+
+#include <ArduinoJson.h>
+#include <StreamUtils/Streams/ReadBufferingStream.hpp>
+#include <unity.h>
+
+#include <string>
+
+#include "benchmark.h"
+#include "chunked_body.h"
+#include "departure_fixtures.h"
+#include "departures.h"
+#include "fixture_stream.h"
+#include "http_body_stream.h"
+
+using StreamUtils::ReadBufferingStream;
+
+// As the TfNSW server and the WiFi connection deliver it
+#define CHUNK_SIZE 4096
+#define PACKET_SIZE 1460
+#define BODY_TIMEOUT 5000
+static const char NEXT_RESPONSE[] = "HTTP/1.1 200 OK\r\n";
+
+struct parseResult {
+  stopDepartures stop;
+  bool parsed;
+  bool drained;
+  size_t numReads;  // of the connection
+  size_t position;  // in the connection once the body is drained
+};
+
+/*
+ * Parses a response the way Bus::fetchForStopId does, from the body of a
+ * keep-alive connection, with or without the read buffer in between.
+ */
+static parseResult parseResponse(const std::string &connection,
+                                 bool buffered) {
+  parseResult result;
+  FixtureStream upstream(connection, PACKET_SIZE);
+  upstream.setTimeout(BODY_TIMEOUT);
+  HttpBodyStream body(upstream);
+  body.setTimeout(BODY_TIMEOUT);
+  body.reset(-1, true);
+  if (buffered) {
+    ReadBufferingStream bufferedStream(body, 256);
+    bufferedStream.setTimeout(BODY_TIMEOUT);
+    result.parsed = parseDepartures(bufferedStream, result.stop, FIXTURE_NOW);
+  } else {
+    result.parsed = parseDepartures(body, result.stop, FIXTURE_NOW);
+  }
+  result.drained = body.drain();
+  result.numReads = upstream.numReads();
+  result.position = upstream.position();
+  return result;
+}
+
+static std::string connectionFor(const departureFixture &fixture) {
+  return chunkedBody(departureMonResponse(fixture), CHUNK_SIZE) +
+         NEXT_RESPONSE;
+}
+
+static void assertBufferedMatchesDirect(const departureFixture &fixture) {
+  std::string connection = connectionFor(fixture);
+  parseResult direct = parseResponse(connection, false);
+  parseResult buffered = parseResponse(connection, true);
+  TEST_ASSERT_TRUE(direct.parsed);
+  TEST_ASSERT_TRUE(buffered.parsed);
+
+  TEST_ASSERT_EQUAL_STRING(direct.stop.description.name,
+                           buffered.stop.description.name);
+  TEST_ASSERT_EQUAL(direct.stop.departures.size(),
+                    buffered.stop.departures.size());
+  for (size_t i = 0; i < direct.stop.departures.size(); i++) {
+    TEST_ASSERT_EQUAL_STRING(direct.stop.departures[i].route,
+                             buffered.stop.departures[i].route);
+    TEST_ASSERT_EQUAL_INT64(direct.stop.departures[i].departureTime,
+                            buffered.stop.departures[i].departureTime);
+  }
+
+  // The read-ahead stops at the end of the body, leaving the next response
+  TEST_ASSERT_TRUE(buffered.drained);
+  TEST_ASSERT_EQUAL(connection.size() - strlen(NEXT_RESPONSE),
+                    buffered.position);
+}
+
+void test_buffered_matches_direct_for_busy_station() {
+  assertBufferedMatchesDirect(busyStation(300));
+}
+
+void test_buffered_matches_direct_with_whitespace() {
+  assertBufferedMatchesDirect({40, 60, 3, 5, true, false});
+}
+
+void test_buffered_matches_direct_for_empty_board() {
+  assertBufferedMatchesDirect({0, 60, 0, 0, false, false});
+}
+
+// A call into mbedtls on the device for every read of the connection
+void test_buffer_cuts_connection_reads() {
+  for (int numStopEvents : {10, 100, 300, 1000}) {
+    std::string connection = connectionFor(busyStation(numStopEvents));
+    size_t directReads = parseResponse(connection, false).numReads;
+    size_t bufferedReads = parseResponse(connection, true).numReads;
+    TEST_ASSERT_LESS_THAN(directReads / 10, bufferedReads);
+  }
+}
+
+#ifdef BENCHMARK
+/*
+ * Parse time and reads of the connection per response, read a byte at a time
+ * against through the buffer. On the device every read of the connection is
+ * a call into mbedtls, which the host time doesn't include.
+ */
+void test_benchmark_parse_times() {
+  for (int numStopEvents : {10, 100, 300, 1000}) {
+    std::string connection = connectionFor(busyStation(numStopEvents));
+    const int runs = 20;
+    size_t directReads = 0;
+    size_t bufferedReads = 0;
+
+    double directMicros = microsPerRun(runs, [&]() {
+      directReads = parseResponse(connection, false).numReads;
+    });
+    double bufferedMicros = microsPerRun(runs, [&]() {
+      bufferedReads = parseResponse(connection, true).numReads;
+    });
+
+    printf("%4d stop events, %6u bytes: byte at a time %8.1f us %6u reads, "
+           "buffered %8.1f us %6u reads\n",
+           numStopEvents, (unsigned)connection.size(), directMicros,
+           (unsigned)directReads, bufferedMicros, (unsigned)bufferedReads);
+  }
+}
+#endif
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_buffered_matches_direct_for_busy_station);
+  RUN_TEST(test_buffered_matches_direct_with_whitespace);
+  RUN_TEST(test_buffered_matches_direct_for_empty_board);
+  RUN_TEST(test_buffer_cuts_connection_reads);
+#ifdef BENCHMARK
+  RUN_TEST(test_benchmark_parse_times);
+#endif
+  return UNITY_END();
+}
@@ -0,0 +1,150 @@
+// The departures kept by parseDepartures(), ordered by a time parsed once,
+// against the old path that parsed the time in the sort comparator.
+
+#include <ArduinoJson.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unity.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "departure_fixtures.h"
+#include "departures.h"
+#include "fixture_stream.h"
+
+static JsonDocument responseDoc;
+static size_t numComparisons;
+
+/*
+ * The old comparator's time lookup: two JSON lookups and a strptime() and
+ * mktime() for every call. TZ is UTC here, so there is no offset to take off.
+ */
+static time_t getDepartureTime(JsonObjectConst stopEvent) {
+  bool isRealtime =
+      stopEvent["isRealtimeControlled"] && stopEvent["departureTimeEstimated"];
+  const char *departureTimeString =
+      stopEvent[isRealtime ? "departureTimeEstimated"
+                           : "departureTimePlanned"] |
+      "";
+  struct tm tm = {};
+  strptime(departureTimeString, "%Y-%m-%dT%H:%M:%SZ", &tm);
+  return mktime(&tm);
+}
+
+static std::vector<JsonObjectConst> sortInComparator(time_t now) {
+  std::vector<JsonObjectConst> shown;
+  JsonArrayConst stopEvents = responseDoc["stopEvents"];
+  for (JsonObjectConst stopEvent : stopEvents) {
+    if (!stopEvent["isCancelled"] &&
+        getDepartureTime(stopEvent) <= now + 60 * 60) {
+      shown.push_back(stopEvent);
+    }
+  }
+  std::stable_sort(shown.begin(), shown.end(),
+                   [](JsonObjectConst a, JsonObjectConst b) {
+                     numComparisons++;
+                     return getDepartureTime(a) < getDepartureTime(b);
+                   });
+  return shown;
+}
+
+static std::string loadStopEvents(int numStopEvents) {
+  // Every event within the hour, as at the busiest stations
+  departureFixture fixture = busyStation(numStopEvents);
+  fixture.secondsApart = 3000 / numStopEvents;
+  std::string response = departureMonResponse(fixture);
+  FixtureStream stream(response);
+  TEST_ASSERT_FALSE(deserializeJson(responseDoc, stream));
+  return response;
+}
+
+void test_parsed_order_matches_comparator_order() {
+  std::string response = loadStopEvents(300);
+  std::vector<JsonObjectConst> expected = sortInComparator(FIXTURE_NOW);
+  TEST_ASSERT_GREATER_THAN(250, expected.size());
+
+  stopDepartures actual;
+  FixtureStream stream(response);
+  TEST_ASSERT_TRUE(parseDepartures(stream, actual, FIXTURE_NOW));
+  TEST_ASSERT_EQUAL(MAX_DEPARTURES, actual.departures.size());
+  for (size_t i = 0; i < actual.departures.size(); i++) {
+    // Same departure, so ties keep the order they were sent in
+    TEST_ASSERT_EQUAL_INT64(getDepartureTime(expected[i]),
+                            actual.departures[i].departureTime);
+    TEST_ASSERT_EQUAL_STRING(
+        expected[i]["transportation"]["destination"]["name"] | "",
+        actual.departures[i].destination);
+  }
+}
+
+#ifdef BENCHMARK
+struct sortKey {
+  time_t departureTime;
+  JsonObjectConst stopEvent;
+};
+
+/*
+ * The sort key stage: each time is parsed once, then the events are ordered
+ * by the cached key.
+ */
+static std::vector<sortKey> sortByKey(time_t now) {
+  std::vector<sortKey> shown;
+  JsonArrayConst stopEvents = responseDoc["stopEvents"];
+  for (JsonObjectConst stopEvent : stopEvents) {
+    bool isRealtime = stopEvent["isRealtimeControlled"] &&
+                      stopEvent["departureTimeEstimated"];
+    time_t departureTime = parseTimeUtc(
+        stopEvent[isRealtime ? "departureTimeEstimated"
+                             : "departureTimePlanned"] |
+        "");
+    if (!stopEvent["isCancelled"] && departureTime <= now + 60 * 60) {
+      shown.push_back({departureTime, stopEvent});
+    }
+  }
+  std::stable_sort(shown.begin(), shown.end(),
+                   [](const sortKey &a, const sortKey &b) {
+                     numComparisons++;
+                     return a.departureTime < b.departureTime;
+                   });
+  return shown;
+}
+
+void test_benchmark_comparator() {
+  loadStopEvents(300);
+  const int runs = 50;
+  size_t shown = 0;
+
+  numComparisons = 0;
+  double comparatorMicros = microsPerRun(
+      runs, [&]() { shown += sortInComparator(FIXTURE_NOW).size(); });
+  size_t comparatorComparisons = numComparisons / runs;
+
+  numComparisons = 0;
+  double keyMicros =
+      microsPerRun(runs, [&]() { shown += sortByKey(FIXTURE_NOW).size(); });
+  size_t keyComparisons = numComparisons / runs;
+
+  printf("300 stop events: parsed in the comparator %8.1f us (%u "
+         "comparisons), parsed once %8.1f us (%u comparisons)\n",
+         comparatorMicros, (unsigned)comparatorComparisons, keyMicros,
+         (unsigned)keyComparisons);
+  TEST_ASSERT_GREATER_THAN(0, shown);
+}
+#endif
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+  setenv("TZ", "UTC", 1);
+  tzset();
+  UNITY_BEGIN();
+  RUN_TEST(test_parsed_order_matches_comparator_order);
+#ifdef BENCHMARK
+  RUN_TEST(test_benchmark_comparator);
+#endif
+  return UNITY_END();
+}
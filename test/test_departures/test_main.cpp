@@ -0,0 +1,276 @@
+// Streaming departure_mon parsing against the filtered document it replaced.
+
+#include <ArduinoJson.h>
+#include <unity.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "departure_fixtures.h"
+#include "departures.h"
+#include "fixture_stream.h"
+#include "heap_tracking.h"
+
+/*
+ * The old path: the whole filtered response is held as one document, then the
+ * events are filtered and sorted by their departure times.
+ */
+static JsonDocument buildResponseFilter() {
+  JsonDocument filter;
+  filter["locations"][0]["disassembledName"] = true;
+  filter["locations"][0]["assignedStops"][0]["modes"] = true;
+  filter["stopEvents"][0]["departureTimePlanned"] = true;
+  filter["stopEvents"][0]["departureTimeEstimated"] = true;
+  filter["stopEvents"][0]["isRealtimeControlled"] = true;
+  filter["stopEvents"][0]["isCancelled"] = true;
+  filter["stopEvents"][0]["location"]["parent"]["disassembledName"] = true;
+  filter["stopEvents"][0]["transportation"]["disassembledName"] = true;
+  filter["stopEvents"][0]["transportation"]["product"]["iconId"] = true;
+  filter["stopEvents"][0]["transportation"]["origin"]["name"] = true;
+  filter["stopEvents"][0]["transportation"]["destination"]["name"] = true;
+  return filter;
+}
+
+static time_t getDepartureTime(JsonObjectConst stopEvent) {
+  bool isRealtime =
+      stopEvent["isRealtimeControlled"] && stopEvent["departureTimeEstimated"];
+  return parseTimeUtc(stopEvent[isRealtime ? "departureTimeEstimated"
+                                           : "departureTimePlanned"] |
+                      "");
+}
+
+static bool parseWithFilter(Stream &stream, JsonDocument &doc,
+                            stopDepartures &stop, time_t now) {
+  static const JsonDocument filter = buildResponseFilter();
+  if (deserializeJson(doc, stream,
+                      DeserializationOption::Filter(
+                          filter.as<JsonVariantConst>()))) {
+    return false;
+  }
+
+  stopDescription &desc = stop.description;
+  desc = {};
+  JsonArrayConst stopEvents = doc["stopEvents"];
+  const char *stopName = doc["locations"][0]["disassembledName"] | "";
+  if (stopEvents.size() > 0) {
+    const char *eventStopName =
+        stopEvents[0]["location"]["parent"]["disassembledName"];
+    for (JsonObjectConst stopEvent : stopEvents) {
+      const char *parentName =
+          stopEvent["location"]["parent"]["disassembledName"];
+      if (!eventStopName || !parentName ||
+          strcmp(eventStopName, parentName) != 0) {
+        eventStopName = NULL;
+      }
+      addIconId(desc, stopEvent["transportation"]["product"]["iconId"]);
+    }
+    if (eventStopName) {
+      stopName = eventStopName;
+    }
+  } else {
+    for (int mode : doc["locations"][0]["assignedStops"][0]["modes"]
+                        .as<JsonArrayConst>()) {
+      addIconId(desc, mode);
+    }
+  }
+  strlcpy(desc.name, stopName, sizeof(desc.name));
+
+  std::vector<JsonObjectConst> shown;
+  for (JsonObjectConst stopEvent : stopEvents) {
+    if (!stopEvent["isCancelled"] &&
+        getDepartureTime(stopEvent) <= now + 60 * 60) {
+      shown.push_back(stopEvent);
+    }
+  }
+  // Stable, so departures at the same time stay in the order they were sent,
+  // as they do in the TopK
+  std::stable_sort(shown.begin(), shown.end(),
+                   [](JsonObjectConst a, JsonObjectConst b) {
+                     return getDepartureTime(a) < getDepartureTime(b);
+                   });
+  for (size_t i = 0; i < shown.size() && i < MAX_DEPARTURES; i++) {
+    Departure departure = {};
+    departure.isRealtime = shown[i]["isRealtimeControlled"] &&
+                           shown[i]["departureTimeEstimated"];
+    departure.iconId = shown[i]["transportation"]["product"]["iconId"];
+    strlcpy(departure.route,
+            shown[i]["transportation"]["disassembledName"] | "",
+            sizeof(departure.route));
+    strlcpy(departure.destination,
+            shown[i]["transportation"]["destination"]["name"] | "",
+            sizeof(departure.destination));
+    departure.departureTime = getDepartureTime(shown[i]);
+    stop.departures.push(departure);
+  }
+  return true;
+}
+
+static void assertSameStop(const stopDepartures &expected,
+                           const stopDepartures &actual) {
+  TEST_ASSERT_EQUAL_STRING(expected.description.name, actual.description.name);
+  TEST_ASSERT_EQUAL(expected.description.numIconIds,
+                    actual.description.numIconIds);
+  if (expected.description.numIconIds > 0) {
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected.description.iconIds,
+                                  actual.description.iconIds,
+                                  expected.description.numIconIds);
+  }
+  TEST_ASSERT_EQUAL(expected.departures.size(), actual.departures.size());
+  for (size_t i = 0; i < expected.departures.size(); i++) {
+    const Departure &a = expected.departures[i];
+    const Departure &b = actual.departures[i];
+    TEST_ASSERT_EQUAL_STRING(a.route, b.route);
+    TEST_ASSERT_EQUAL_STRING(a.destination, b.destination);
+    TEST_ASSERT_EQUAL_INT64(a.departureTime, b.departureTime);
+    TEST_ASSERT_EQUAL(a.isRealtime, b.isRealtime);
+    TEST_ASSERT_EQUAL(a.iconId, b.iconId);
+  }
+}
+
+static void assertMatchesFilterPath(const departureFixture &fixture) {
+  std::string response = departureMonResponse(fixture);
+  stopDepartures expected;
+  JsonDocument doc;
+  FixtureStream expectedStream(response);
+  TEST_ASSERT_TRUE(
+      parseWithFilter(expectedStream, doc, expected, FIXTURE_NOW));
+
+  stopDepartures actual;
+  FixtureStream stream(response);
+  TEST_ASSERT_TRUE(parseDepartures(stream, actual, FIXTURE_NOW));
+  assertSameStop(expected, actual);
+}
+
+void test_matches_filter_path_for_busy_station() {
+  assertMatchesFilterPath(busyStation(300));
+
+  stopDepartures stop;
+  std::string response = departureMonResponse(busyStation(300));
+  FixtureStream stream(response);
+  TEST_ASSERT_TRUE(parseDepartures(stream, stop, FIXTURE_NOW));
+  TEST_ASSERT_EQUAL_STRING("Central Station", stop.description.name);
+  TEST_ASSERT_EQUAL(MAX_DEPARTURES, stop.departures.size());
+}
+
+void test_matches_filter_path_for_quiet_stop() {
+  assertMatchesFilterPath({3, 600, 0, 0, false, false});
+}
+
+void test_matches_filter_path_with_whitespace() {
+  assertMatchesFilterPath({40, 60, 3, 5, true, false});
+}
+
+void test_falls_back_to_location_name_for_mixed_parents() {
+  assertMatchesFilterPath({12, 60, 2, 0, false, true});
+
+  stopDepartures stop;
+  std::string response = departureMonResponse({12, 60, 2, 0, false, true});
+  FixtureStream stream(response);
+  TEST_ASSERT_TRUE(parseDepartures(stream, stop, FIXTURE_NOW));
+  TEST_ASSERT_EQUAL_STRING("Central", stop.description.name);
+}
+
+void test_no_stop_events_uses_assigned_modes() {
+  assertMatchesFilterPath({0, 60, 0, 0, true, false});
+
+  stopDepartures stop;
+  std::string response = departureMonResponse({0, 60, 0, 0, false, false});
+  FixtureStream stream(response);
+  TEST_ASSERT_TRUE(parseDepartures(stream, stop, FIXTURE_NOW));
+  TEST_ASSERT_EQUAL(0, stop.departures.size());
+  const uint8_t modes[] = {1, 2, 4, 5};
+  TEST_ASSERT_EQUAL(4, stop.description.numIconIds);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(modes, stop.description.iconIds, 4);
+}
+
+void test_truncated_response_fails() {
+  std::string response = departureMonResponse(busyStation(20));
+  response.resize(response.size() / 2);
+  stopDepartures stop;
+  FixtureStream stream(response);
+  stream.setTimeout(0);
+  TEST_ASSERT_FALSE(parseDepartures(stream, stop, FIXTURE_NOW));
+}
+
+// The most heap held at once is less than the filtered document needs
+void test_heap_stays_below_filter_path() {
+  if (!heapTrackingAvailable()) {
+    TEST_IGNORE_MESSAGE("heap tracking needs glibc");
+  }
+  for (int numStopEvents : {100, 300, 1000}) {
+    std::string response = departureMonResponse(busyStation(numStopEvents));
+    long filterHeap = peakHeapUsed([&]() {
+      stopDepartures stop;
+      JsonDocument doc;
+      FixtureStream stream(response);
+      parseWithFilter(stream, doc, stop, FIXTURE_NOW);
+    });
+    long streamHeap = peakHeapUsed([&]() {
+      stopDepartures stop;
+      FixtureStream stream(response);
+      parseDepartures(stream, stop, FIXTURE_NOW);
+    });
+    TEST_ASSERT_LESS_THAN(filterHeap, streamHeap);
+  }
+}
+
+#ifdef BENCHMARK
+/*
+ * Parse time and the most heap held at once for growing responses, streamed
+ * against the filtered document.
+ */
+void test_benchmark_against_filter_path() {
+  for (int numStopEvents : {10, 100, 300, 1000}) {
+    std::string response = departureMonResponse(busyStation(numStopEvents));
+    const int runs = 20;
+
+    double filterMicros = microsPerRun(runs, [&]() {
+      stopDepartures stop;
+      JsonDocument doc;
+      FixtureStream stream(response);
+      parseWithFilter(stream, doc, stop, FIXTURE_NOW);
+    });
+    double streamMicros = microsPerRun(runs, [&]() {
+      stopDepartures stop;
+      FixtureStream stream(response);
+      parseDepartures(stream, stop, FIXTURE_NOW);
+    });
+    long filterHeap = peakHeapUsed([&]() {
+      stopDepartures stop;
+      JsonDocument doc;
+      FixtureStream stream(response);
+      parseWithFilter(stream, doc, stop, FIXTURE_NOW);
+    });
+    long streamHeap = peakHeapUsed([&]() {
+      stopDepartures stop;
+      FixtureStream stream(response);
+      parseDepartures(stream, stop, FIXTURE_NOW);
+    });
+
+    printf("%4d stop events, %6u bytes: filtered document %8.1f us %6ld "
+           "bytes peak, streamed %8.1f us %6ld bytes peak\n",
+           numStopEvents, (unsigned)response.size(), filterMicros, filterHeap,
+           streamMicros, streamHeap);
+  }
+}
+#endif
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_matches_filter_path_for_busy_station);
+  RUN_TEST(test_matches_filter_path_for_quiet_stop);
+  RUN_TEST(test_matches_filter_path_with_whitespace);
+  RUN_TEST(test_falls_back_to_location_name_for_mixed_parents);
+  RUN_TEST(test_no_stop_events_uses_assigned_modes);
+  RUN_TEST(test_truncated_response_fails);
+  RUN_TEST(test_heap_stays_below_filter_path);
+#ifdef BENCHMARK
+  RUN_TEST(test_benchmark_against_filter_path);
+#endif
+  return UNITY_END();
+}
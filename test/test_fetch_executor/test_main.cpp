@@ -0,0 +1,303 @@
+// FetchExecutor's std::thread tasks against stand-in servers on the loopback
+// interface that take as long to answer as the real ones do over WiFi.
+
+#include <Arduino.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <unity.h>
+
+#include <atomic>
+#include <thread>
+
+#include "benchmark.h"
+#include "fetch_executor.h"
+#include "socket_connect.h"
+
+#define CONNECT_TIMEOUT 2000
+
+/*
+ * Answers each request after latencyMs with a two byte body, or closes the
+ * connection without one if it is set to fail.
+ */
+class StandInServer {
+ public:
+  StandInServer(uint32_t latencyMs, bool fails = false)
+      : _latencyMs(latencyMs), _fails(fails) {
+    _listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(_listener, (struct sockaddr *)&address, sizeof(address));
+    listen(_listener, 16);
+    socklen_t length = sizeof(address);
+    getsockname(_listener, (struct sockaddr *)&address, &length);
+    _port = ntohs(address.sin_port);
+    _accepting = std::thread([this]() { accept(); });
+  }
+
+  ~StandInServer() {
+    // Wakes the accept() that is waiting
+    shutdown(_listener, SHUT_RDWR);
+    _accepting.join();
+    close(_listener);
+  }
+
+  uint16_t port() const { return _port; }
+
+ private:
+  int _listener;
+  uint16_t _port;
+  uint32_t _latencyMs;
+  bool _fails;
+  std::thread _accepting;
+
+  void accept() {
+    int fd;
+    while ((fd = ::accept(_listener, NULL, NULL)) >= 0) {
+      std::thread([fd, latencyMs = _latencyMs, fails = _fails]() {
+        char request[16];
+        recv(fd, request, sizeof(request), 0);
+        delay(latencyMs);
+        if (!fails) {
+          send(fd, "ok", 2, 0);
+        }
+        close(fd);
+      }).detach();
+    }
+  }
+};
+
+// An app whose fetch is a request to its stand-in server
+class StandInApp : public IApp {
+ public:
+  explicit StandInApp(uint16_t port)
+      : numFetched(0), numCommitted(0), _port(port) {}
+
+  bool fetchData() override {
+    int fd = connectSocket("127.0.0.1", _port, CONNECT_TIMEOUT);
+    if (fd < 0) {
+      return false;
+    }
+    send(fd, "GET", 3, 0);
+    char body[8];
+    size_t length = 0;
+    ssize_t n;
+    while ((n = recv(fd, body + length, sizeof(body) - length, 0)) > 0) {
+      length += n;
+    }
+    close(fd);
+    numFetched++;
+    return length == 2;
+  }
+  void commitData() override { numCommitted++; }
+  void setRenderArea(const Rect &) override {}
+  void render() override {}
+  size_t digestRegions(Rect[], uint32_t[]) override { return 0; }
+  uint32_t maxAge() override { return 0; }
+  bool restoreData(bool) override { return false; }
+
+  std::atomic<int> numFetched;  // whether or not they succeeded
+  int numCommitted;
+
+ private:
+  uint16_t _port;
+};
+
+void test_fetches_every_app() {
+  StandInServer weatherServer(50);
+  StandInServer busServer(80);
+  StandInApp weather(weatherServer.port());
+  StandInApp bus(busServer.port());
+  IApp *apps[] = {&weather, &bus};
+  fetchStatus_t statuses[2];
+
+  FetchExecutor executor;
+  executor.run(apps, 2, 5000, statuses);
+  TEST_ASSERT_EQUAL(FETCH_OK, statuses[0]);
+  TEST_ASSERT_EQUAL(FETCH_OK, statuses[1]);
+  TEST_ASSERT_EQUAL(1, weather.numFetched);
+  TEST_ASSERT_EQUAL(1, bus.numFetched);
+
+  IApp *lateApps[MAX_FETCH_TASKS];
+  time_t finishTimes[MAX_FETCH_TASKS];
+  TEST_ASSERT_EQUAL(0, executor.wait(0, lateApps, finishTimes));
+  TEST_ASSERT_EQUAL(0, executor.numRunning());
+}
+
+void test_reports_failed_fetches() {
+  StandInServer failing(20, true);
+  StandInServer answering(20);
+  StandInApp failed(failing.port());
+  StandInApp fetched(answering.port());
+  IApp *apps[] = {&failed, &fetched};
+  fetchStatus_t statuses[2];
+
+  FetchExecutor executor;
+  executor.run(apps, 2, 5000, statuses);
+  TEST_ASSERT_EQUAL(FETCH_FAILED, statuses[0]);
+  TEST_ASSERT_EQUAL(FETCH_OK, statuses[1]);
+}
+
+/*
+ * A fetch that misses the deadline doesn't hold up the cycle, and what it
+ * fetches afterwards is handed back by wait(), once, with when it finished.
+ */
+void test_hands_back_late_fetches() {
+  StandInServer slowServer(400);
+  StandInServer fastServer(20);
+  StandInApp slow(slowServer.port());
+  StandInApp fast(fastServer.port());
+  IApp *apps[] = {&slow, &fast};
+  fetchStatus_t statuses[2];
+
+  FetchExecutor executor;
+  time_t runTime = time(NULL);
+  unsigned long start = millis();
+  executor.run(apps, 2, 150, statuses);
+  TEST_ASSERT_INT_WITHIN(50, 150, millis() - start);
+  TEST_ASSERT_EQUAL(FETCH_TIMED_OUT, statuses[0]);
+  TEST_ASSERT_EQUAL(FETCH_OK, statuses[1]);
+  TEST_ASSERT_EQUAL(0, slow.numFetched);
+  TEST_ASSERT_EQUAL(1, executor.numRunning());
+
+  IApp *lateApps[MAX_FETCH_TASKS];
+  time_t finishTimes[MAX_FETCH_TASKS];
+  TEST_ASSERT_EQUAL(1, executor.wait(5000, lateApps, finishTimes));
+  TEST_ASSERT_EQUAL_PTR(&slow, lateApps[0]);
+  TEST_ASSERT_GREATER_OR_EQUAL(400, millis() - start);
+  TEST_ASSERT_GREATER_OR_EQUAL(runTime, finishTimes[0]);
+  TEST_ASSERT_LESS_OR_EQUAL(time(NULL), finishTimes[0]);
+  TEST_ASSERT_EQUAL(0, executor.numRunning());
+  TEST_ASSERT_EQUAL(0, executor.wait(0, lateApps, finishTimes));
+}
+
+// wait() gives up after its timeout, and the fetch is handed back later
+void test_wait_leaves_slow_fetches_running() {
+  StandInServer slowServer(400);
+  StandInApp slow(slowServer.port());
+  IApp *apps[] = {&slow};
+  fetchStatus_t statuses[1];
+
+  FetchExecutor executor;
+  executor.run(apps, 1, 50, statuses);
+  TEST_ASSERT_EQUAL(FETCH_TIMED_OUT, statuses[0]);
+
+  IApp *lateApps[MAX_FETCH_TASKS];
+  time_t finishTimes[MAX_FETCH_TASKS];
+  unsigned long start = millis();
+  TEST_ASSERT_EQUAL(0, executor.wait(50, lateApps, finishTimes));
+  TEST_ASSERT_LESS_THAN(300, millis() - start);
+  TEST_ASSERT_EQUAL(1, executor.numRunning());
+
+  TEST_ASSERT_EQUAL(1, executor.wait(5000, lateApps, finishTimes));
+  TEST_ASSERT_EQUAL_PTR(&slow, lateApps[0]);
+  TEST_ASSERT_EQUAL(0, executor.numRunning());
+}
+
+void test_late_failures_are_not_handed_back() {
+  StandInServer slowServer(300, true);
+  StandInApp slow(slowServer.port());
+  IApp *apps[] = {&slow};
+  fetchStatus_t statuses[1];
+
+  FetchExecutor executor;
+  executor.run(apps, 1, 100, statuses);
+  TEST_ASSERT_EQUAL(FETCH_TIMED_OUT, statuses[0]);
+
+  IApp *lateApps[MAX_FETCH_TASKS];
+  time_t finishTimes[MAX_FETCH_TASKS];
+  TEST_ASSERT_EQUAL(0, executor.wait(5000, lateApps, finishTimes));
+  TEST_ASSERT_EQUAL(1, slow.numFetched);
+  TEST_ASSERT_EQUAL(0, executor.numRunning());
+}
+
+/*
+ * An app still fetching from the last run isn't started again, the next run
+ * doesn't wait for it, and it is fetched again once it has finished.
+ */
+void test_run_skips_apps_still_fetching() {
+  StandInServer slowServer(300);
+  StandInServer fastServer(20);
+  StandInApp slow(slowServer.port());
+  StandInApp fast(fastServer.port());
+  IApp *apps[] = {&slow, &fast};
+  fetchStatus_t statuses[2];
+
+  FetchExecutor executor;
+  executor.run(apps, 1, 50, statuses);
+  TEST_ASSERT_EQUAL(FETCH_TIMED_OUT, statuses[0]);
+
+  unsigned long start = millis();
+  executor.run(apps, 2, 5000, statuses);
+  TEST_ASSERT_LESS_THAN(250, millis() - start);
+  TEST_ASSERT_EQUAL(FETCH_TIMED_OUT, statuses[0]);
+  TEST_ASSERT_EQUAL(FETCH_OK, statuses[1]);
+
+  IApp *lateApps[MAX_FETCH_TASKS];
+  time_t finishTimes[MAX_FETCH_TASKS];
+  TEST_ASSERT_EQUAL(1, executor.wait(5000, lateApps, finishTimes));
+  TEST_ASSERT_EQUAL(1, slow.numFetched);
+  executor.run(apps, 1, 5000, statuses);
+  TEST_ASSERT_EQUAL(FETCH_OK, statuses[0]);
+  TEST_ASSERT_EQUAL(2, slow.numFetched);
+}
+
+#ifdef BENCHMARK
+/*
+ * The time to fetch every app, one after the other on the main task against
+ * concurrently, for server latencies seen over WiFi.
+ */
+void test_benchmark_against_sequential() {
+  for (size_t numApps : {2, 4}) {
+    for (uint32_t latencyMs : {50, 100, 200}) {
+      StandInServer server(latencyMs);
+      StandInApp *standIns[4];
+      IApp *apps[4];
+      for (size_t i = 0; i < numApps; i++) {
+        apps[i] = standIns[i] = new StandInApp(server.port());
+      }
+      const int runs = 3;
+
+      double sequentialMicros = microsPerRun(runs, [&]() {
+        for (size_t i = 0; i < numApps; i++) {
+          TEST_ASSERT_TRUE(apps[i]->fetchData());
+        }
+      });
+      FetchExecutor executor;
+      double concurrentMicros = microsPerRun(runs, [&]() {
+        fetchStatus_t statuses[4];
+        executor.run(apps, numApps, 10000, statuses);
+        for (size_t i = 0; i < numApps; i++) {
+          TEST_ASSERT_EQUAL(FETCH_OK, statuses[i]);
+        }
+      });
+
+      printf("%u apps, %3u ms latency: one after the other %6.1f ms, "
+             "concurrent %6.1f ms\n",
+             (unsigned)numApps, (unsigned)latencyMs, sequentialMicros / 1000,
+             concurrentMicros / 1000);
+      for (size_t i = 0; i < numApps; i++) {
+        delete standIns[i];
+      }
+    }
+  }
+}
+#endif
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_fetches_every_app);
+  RUN_TEST(test_reports_failed_fetches);
+  RUN_TEST(test_hands_back_late_fetches);
+  RUN_TEST(test_wait_leaves_slow_fetches_running);
+  RUN_TEST(test_late_failures_are_not_handed_back);
+  RUN_TEST(test_run_skips_apps_still_fetching);
+#ifdef BENCHMARK
+  RUN_TEST(test_benchmark_against_sequential);
+#endif
+  return UNITY_END();
+}
@@ -0,0 +1,185 @@
+// Streaming the OpenWeather 3 hourly forecast one entry at a time, on
+// recorded-shape responses of any length.
+
+#include <ArduinoJson.h>
+#include <unity.h>
+
+#include <string>
+
+#include "benchmark.h"
+#include "fixture_stream.h"
+#include "heap_tracking.h"
+#include "weather_fixtures.h"
+#include "weather_report.h"
+
+/*
+ * The most heap parseForecast() may hold at once, whatever the number of
+ * entries: one filtered entry's JsonDocument. Generous for the host's 64 bit
+ * slots, the ESP32's are half the size.
+ */
+#define FORECAST_HEAP_BUDGET 8192
+
+static void assertParsesFirstPoints(int numEntries, bool pretty,
+                                    size_t burst) {
+  std::string response = forecastResponse(numEntries, pretty);
+  FixtureStream stream(response, burst);
+  forecastPoints forecast;
+  TEST_ASSERT_TRUE(parseForecast(stream, forecast));
+
+  int numPoints = numEntries < FORECAST_POINTS ? numEntries : FORECAST_POINTS;
+  TEST_ASSERT_EQUAL(numPoints, forecast.numPoints);
+  if (numPoints == 0) {
+    return;
+  }
+  TEST_ASSERT_EQUAL_INT64(FORECAST_START, forecast.startTime);
+  TEST_ASSERT_EQUAL(numPoints > 1 ? FORECAST_INTERVAL : 0, forecast.interval);
+  for (int i = 0; i < numPoints; i++) {
+    TEST_ASSERT_EQUAL(forecastTenths(i), forecast.points[i].temperature);
+    TEST_ASSERT_EQUAL(forecastPop(i), forecast.points[i].pop);
+  }
+}
+
+void test_parses_every_point_of_a_short_forecast() {
+  assertParsesFirstPoints(1, false, 0);
+  assertParsesFirstPoints(8, false, 0);
+  assertParsesFirstPoints(FORECAST_POINTS, false, 0);
+}
+
+void test_keeps_the_first_points_of_a_long_forecast() {
+  assertParsesFirstPoints(FORECAST_POINTS + 1, false, 0);
+  // Every step of the 5 day forecast
+  assertParsesFirstPoints(40, false, 0);
+  assertParsesFirstPoints(200, false, 0);
+}
+
+void test_parses_indented_and_packetized_responses() {
+  assertParsesFirstPoints(40, true, 0);
+  assertParsesFirstPoints(40, false, 1460);
+  assertParsesFirstPoints(40, true, 100);
+}
+
+void test_empty_list_has_no_points() {
+  assertParsesFirstPoints(0, false, 0);
+  assertParsesFirstPoints(0, true, 0);
+}
+
+void test_response_without_list_fails() {
+  std::string response = currentWeatherResponse();
+  FixtureStream stream(response);
+  stream.setTimeout(0);
+  forecastPoints forecast;
+  TEST_ASSERT_FALSE(parseForecast(stream, forecast));
+  TEST_ASSERT_EQUAL(0, forecast.numPoints);
+}
+
+void test_truncated_entry_fails() {
+  std::string response = forecastResponse(8);
+  // Part way through the last entry
+  response.resize(response.rfind("\"pop\""));
+  FixtureStream stream(response);
+  stream.setTimeout(0);
+  forecastPoints forecast;
+  TEST_ASSERT_FALSE(parseForecast(stream, forecast));
+}
+
+// The whole response parsed into one document, with the entry filter per item
+static bool parseWholeList(Stream &stream) {
+  JsonDocument filter;
+  filter["list"][0]["dt"] = true;
+  filter["list"][0]["main"]["temp"] = true;
+  filter["list"][0]["pop"] = true;
+  JsonDocument doc;
+  DeserializationError err = deserializeJson(
+      doc, stream,
+      DeserializationOption::Filter(filter.as<JsonVariantConst>()));
+  return !err && doc["list"].size() > 0;
+}
+
+/*
+ * The most heap held at once to parse 8 entries to a whole 5 day forecast and
+ * more, against the budget and against the whole list in one document.
+ */
+void test_heap_stays_within_budget() {
+  if (!heapTrackingAvailable()) {
+    TEST_IGNORE_MESSAGE("heap tracking needs glibc");
+  }
+  // Builds the entry filter, which is then kept for every cycle
+  {
+    std::string response = forecastResponse(1);
+    FixtureStream stream(response);
+    forecastPoints forecast;
+    parseForecast(stream, forecast);
+  }
+
+  long firstHeap = -1;
+  for (int numEntries : {8, 40, 200}) {
+    std::string response = forecastResponse(numEntries);
+    long streamHeap = peakHeapUsed([&]() {
+      FixtureStream stream(response);
+      forecastPoints forecast;
+      TEST_ASSERT_TRUE(parseForecast(stream, forecast));
+    });
+    TEST_ASSERT_LESS_OR_EQUAL(FORECAST_HEAP_BUDGET, streamHeap);
+    // The same for every length of response, only one entry is ever held
+    if (firstHeap < 0) {
+      firstHeap = streamHeap;
+    }
+    TEST_ASSERT_EQUAL(firstHeap, streamHeap);
+    if (numEntries >= 200) {
+      long wholeHeap = peakHeapUsed([&]() {
+        FixtureStream stream(response);
+        TEST_ASSERT_TRUE(parseWholeList(stream));
+      });
+      TEST_ASSERT_LESS_THAN(wholeHeap, streamHeap);
+    }
+  }
+}
+
+#ifdef BENCHMARK
+// Parse time and the most heap held at once, streamed against the whole list
+void test_benchmark_against_whole_list() {
+  for (int numEntries : {8, 40, 200}) {
+    std::string response = forecastResponse(numEntries);
+    const int runs = 50;
+    double streamMicros = microsPerRun(runs, [&]() {
+      FixtureStream stream(response);
+      forecastPoints forecast;
+      parseForecast(stream, forecast);
+    });
+    long streamHeap = peakHeapUsed([&]() {
+      FixtureStream stream(response);
+      forecastPoints forecast;
+      parseForecast(stream, forecast);
+    });
+    long wholeHeap = peakHeapUsed([&]() {
+      FixtureStream stream(response);
+      parseWholeList(stream);
+    });
+
+    printf("%3d entries, %6u bytes: streamed %8.1f us %5ld bytes peak, "
+           "whole list %6ld bytes peak\n",
+           numEntries, (unsigned)response.size(), streamMicros, streamHeap,
+           wholeHeap);
+  }
+  printf("The parsed forecast holds %u bytes\n",
+         (unsigned)sizeof(forecastPoints));
+}
+#endif
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_parses_every_point_of_a_short_forecast);
+  RUN_TEST(test_keeps_the_first_points_of_a_long_forecast);
+  RUN_TEST(test_parses_indented_and_packetized_responses);
+  RUN_TEST(test_empty_list_has_no_points);
+  RUN_TEST(test_response_without_list_fails);
+  RUN_TEST(test_truncated_entry_fails);
+  RUN_TEST(test_heap_stays_within_budget);
+#ifdef BENCHMARK
+  RUN_TEST(test_benchmark_against_whole_list);
+#endif
+  return UNITY_END();
+}
@@ -0,0 +1,266 @@
+// FrameBuffer's byte at a time fills and bitmaps against the same drawing done
+// one drawPixel() at a time on a canvas with the same layout.
+
+#include <Adafruit_GFX.h>
+#include <GxEPD2.h>
+#include <stdlib.h>
+#include <unity.h>
+
+#include <vector>
+
+#include "benchmark.h"
+#include "frame_buffer.h"
+
+// The panel, and one whose rows don't end on a byte
+#define PANEL_WIDTH 800
+#define PANEL_HEIGHT 480
+#define ODD_WIDTH 101
+#define ODD_HEIGHT 61
+
+static void fillRectPerPixel(Adafruit_GFX &gfx, int16_t x, int16_t y,
+                             int16_t w, int16_t h, uint16_t color) {
+  for (int16_t j = y; j < y + h; j++) {
+    for (int16_t i = x; i < x + w; i++) {
+      gfx.drawPixel(i, j, color);
+    }
+  }
+}
+
+static void drawBitmapPerPixel(Adafruit_GFX &gfx, int16_t x, int16_t y,
+                               const uint8_t bitmap[], int16_t w, int16_t h,
+                               uint16_t color, bool inverted) {
+  int16_t byteWidth = (w + 7) / 8;
+  for (int16_t j = 0; j < h; j++) {
+    for (int16_t i = 0; i < w; i++) {
+      bool set = bitmap[j * byteWidth + i / 8] & (0x80 >> (i & 7));
+      if (set != inverted) {
+        gfx.drawPixel(x + i, y + j, color);
+      }
+    }
+  }
+}
+
+static std::vector<uint8_t> randomBitmap(int16_t w, int16_t h) {
+  std::vector<uint8_t> bitmap((w + 7) / 8 * h);
+  for (uint8_t &b : bitmap) {
+    b = rand();
+  }
+  return bitmap;
+}
+
+/*
+ * A frame buffer and the canvas it is checked against, both starting from the
+ * same noise so that drawing black and white both show.
+ */
+struct frames {
+  FrameBuffer buffer;
+  GFXcanvas1 expected;
+
+  frames(int16_t w, int16_t h) : buffer(w, h), expected(w, h) {
+    TEST_ASSERT_TRUE(buffer.allocate(0));
+    for (int16_t y = 0; y < h; y++) {
+      for (int16_t x = 0; x < w; x++) {
+        uint16_t color = rand() & 1 ? GxEPD_WHITE : GxEPD_BLACK;
+        buffer.drawPixel(x, y, color);
+        expected.drawPixel(x, y, color);
+      }
+    }
+  }
+  void setRotation(uint8_t r) {
+    buffer.setRotation(r);
+    expected.setRotation(r);
+  }
+  // Whether every pixel matches, ignoring the unused bits at the end of rows
+  bool same() const {
+    int16_t w = buffer.getRotation() & 1 ? buffer.height() : buffer.width();
+    size_t byteWidth = (w + 7) / 8;
+    uint8_t lastMask = (w & 7) ? 0xFF << (8 - (w & 7)) : 0xFF;
+    for (size_t i = 0; i < buffer.bufferSize(); i++) {
+      uint8_t mask = i % byteWidth == byteWidth - 1 ? lastMask : 0xFF;
+      if ((buffer.buffer()[i] ^ expected.getBuffer()[i]) & mask) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+/*
+ * Every start bit and width of a row up to three bytes long, in every
+ * rotation, so each edge mask and the memset between them is hit.
+ */
+void test_fill_rect_matches_per_pixel() {
+  frames f(ODD_WIDTH, ODD_HEIGHT);
+  for (uint8_t rotation = 0; rotation < 4; rotation++) {
+    f.setRotation(rotation);
+    for (int16_t x = 0; x < 16; x++) {
+      for (int16_t w = 1; w <= 24; w++) {
+        uint16_t color = (x + w) & 1 ? GxEPD_WHITE : GxEPD_BLACK;
+        f.buffer.fillRect(x + 3, 5, w, 7, color);
+        fillRectPerPixel(f.expected, x + 3, 5, w, 7, color);
+        f.buffer.drawFastHLine(x, 20, w, !color);
+        fillRectPerPixel(f.expected, x, 20, w, 1, !color);
+        f.buffer.drawFastVLine(30, x, w, color);
+        fillRectPerPixel(f.expected, 30, x, 1, w, color);
+        char message[48];
+        snprintf(message, sizeof(message), "rotation %d, x %d, width %d",
+                 rotation, x, w);
+        TEST_ASSERT_TRUE_MESSAGE(f.same(), message);
+      }
+    }
+  }
+}
+
+// Rectangles hanging off each edge and corner, and ones with no area
+void test_fill_rect_clips_to_the_buffer() {
+  frames f(ODD_WIDTH, ODD_HEIGHT);
+  for (uint8_t rotation = 0; rotation < 4; rotation++) {
+    f.setRotation(rotation);
+    int16_t width = f.buffer.width();
+    int16_t height = f.buffer.height();
+    for (int x : {-30, -1, 0, 7, width - 9, (int)width}) {
+      for (int y : {-30, -1, 0, height - 5, (int)height}) {
+        for (int w : {-3, 0, 1, 20, 200}) {
+          uint16_t color = (x ^ y ^ w) & 1 ? GxEPD_WHITE : GxEPD_BLACK;
+          f.buffer.fillRect(x, y, w, 12, color);
+          fillRectPerPixel(f.expected, x, y, w, 12, color);
+          TEST_ASSERT_TRUE(f.same());
+        }
+      }
+    }
+  }
+  f.setRotation(0);
+  f.buffer.fillScreen(GxEPD_WHITE);
+  fillRectPerPixel(f.expected, 0, 0, ODD_WIDTH, ODD_HEIGHT, GxEPD_WHITE);
+  TEST_ASSERT_TRUE(f.same());
+}
+
+/*
+ * Bitmaps of every width up to three bytes at every bit offset, drawn both
+ * ways round in each rotation, including heights that leave part of an 8x8
+ * block in rotation 3.
+ */
+void test_bitmaps_match_per_pixel() {
+  frames f(ODD_WIDTH, ODD_HEIGHT);
+  for (uint8_t rotation = 0; rotation < 4; rotation++) {
+    f.setRotation(rotation);
+    for (int16_t w = 1; w <= 24; w++) {
+      for (int16_t h : {1, 7, 8, 13}) {
+        std::vector<uint8_t> bitmap = randomBitmap(w, h);
+        for (int16_t x = 0; x < 8; x++) {
+          for (bool inverted : {false, true}) {
+            uint16_t color = (w + x) & 1 ? GxEPD_WHITE : GxEPD_BLACK;
+            if (inverted) {
+              f.buffer.drawInvertedBitmap(x + 17, 9, bitmap.data(), w, h,
+                                          color);
+            } else {
+              f.buffer.drawBitmap(x + 17, 9, bitmap.data(), w, h, color);
+            }
+            drawBitmapPerPixel(f.expected, x + 17, 9, bitmap.data(), w, h,
+                               color, inverted);
+            char message[64];
+            snprintf(message, sizeof(message),
+                     "rotation %d, %dx%d at x %d, inverted %d", rotation, w,
+                     h, x, inverted);
+            TEST_ASSERT_TRUE_MESSAGE(f.same(), message);
+          }
+        }
+      }
+    }
+  }
+}
+
+/*
+ * Random fills and bitmaps over the whole panel, some of them partly off it,
+ * as the renderer draws them.
+ */
+void test_random_drawing_matches_per_pixel() {
+  frames f(PANEL_WIDTH, PANEL_HEIGHT);
+  for (int i = 0; i < 4000; i++) {
+    f.setRotation(rand() % 4);
+    int16_t width = f.buffer.width();
+    int16_t height = f.buffer.height();
+    uint16_t color = rand() & 1 ? GxEPD_WHITE : GxEPD_BLACK;
+    int16_t w = 1 + rand() % 64;
+    int16_t h = 1 + rand() % 64;
+    int16_t x = rand() % (width + w) - w / 2 - 8;
+    int16_t y = rand() % (height + h) - h / 2 - 8;
+    if (i % 2) {
+      f.buffer.fillRect(x, y, w, h, color);
+      fillRectPerPixel(f.expected, x, y, w, h, color);
+    } else {
+      std::vector<uint8_t> bitmap = randomBitmap(w, h);
+      bool inverted = rand() & 1;
+      if (inverted) {
+        f.buffer.drawInvertedBitmap(x, y, bitmap.data(), w, h, color);
+      } else {
+        f.buffer.drawBitmap(x, y, bitmap.data(), w, h, color);
+      }
+      drawBitmapPerPixel(f.expected, x, y, bitmap.data(), w, h, color,
+                         inverted);
+    }
+    TEST_ASSERT_TRUE(f.same());
+  }
+}
+
+#ifdef BENCHMARK
+/*
+ * Time for the fills and bitmaps of a frame, in rotation 3 as the display is
+ * used, drawn pixel by pixel against the byte at a time kernels.
+ */
+void test_benchmark_against_per_pixel() {
+  FrameBuffer buffer(PANEL_WIDTH, PANEL_HEIGHT);
+  TEST_ASSERT_TRUE(buffer.allocate(0));
+  buffer.setRotation(3);
+  std::vector<uint8_t> icon = randomBitmap(192, 192);
+  const int runs = 500;
+
+  struct {
+    const char *name;
+    int16_t x, y, w, h;
+    bool bitmap;
+  } cases[] = {
+      {"whole screen fill", 0, 0, PANEL_HEIGHT, PANEL_WIDTH, false},
+      {"424x2 rule", 28, 381, 424, 2, false},
+      {"12x30 rain bar", 41, 300, 12, 30, false},
+      {"192x192 weather icon", 143, 200, 192, 192, true},
+      {"32x32 forecast icon", 30, 301, 32, 32, true},
+      {"18x18 status icon", 37, 5, 18, 18, true},
+  };
+  for (const auto &c : cases) {
+    double perPixelMicros = microsPerRun(runs, [&]() {
+      if (c.bitmap) {
+        drawBitmapPerPixel(buffer, c.x, c.y, icon.data(), c.w, c.h,
+                           GxEPD_BLACK, true);
+      } else {
+        fillRectPerPixel(buffer, c.x, c.y, c.w, c.h, GxEPD_BLACK);
+      }
+    });
+    double kernelMicros = microsPerRun(runs, [&]() {
+      if (c.bitmap) {
+        buffer.drawInvertedBitmap(c.x, c.y, icon.data(), c.w, c.h,
+                                  GxEPD_BLACK);
+      } else {
+        buffer.fillRect(c.x, c.y, c.w, c.h, GxEPD_BLACK);
+      }
+    });
+    printf("%-22s per pixel %8.2f us, a byte at a time %7.2f us\n", c.name,
+           perPixelMicros, kernelMicros);
+  }
+}
+#endif
+
+void setUp() { srand(25); }
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_fill_rect_matches_per_pixel);
+  RUN_TEST(test_fill_rect_clips_to_the_buffer);
+  RUN_TEST(test_bitmaps_match_per_pixel);
+  RUN_TEST(test_random_drawing_matches_per_pixel);
+#ifdef BENCHMARK
+  RUN_TEST(test_benchmark_against_per_pixel);
+#endif
+  return UNITY_END();
+}
@@ -0,0 +1,210 @@
+// HttpBodyStream over recorded keep-alive connections.
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <string>
+
+#include "chunked_body.h"
+#include "fixture_stream.h"
+#include "http_body_stream.h"
+
+// As FetchSession sets it, so a drain that waits for nothing stands out
+#define BODY_TIMEOUT 5000
+// Longer than reading any of these bodies, much shorter than the timeout
+#define QUICK_MILLIS 500
+
+static const char BODY[] = "{\"stopEvents\":[{\"departureTimePlanned\":"
+                           "\"2024-06-03T08:00:30Z\"}]}";
+// Sent after each body, to check that the connection is left at its start
+static const char NEXT_RESPONSE[] = "HTTP/1.1 200 OK\r\n";
+
+// Without stalls, as readBytes() would wait out the timeout at the end
+static std::string readAll(Stream &stream) {
+  std::string read;
+  int c;
+  while ((c = stream.read()) >= 0) {
+    read += (char)c;
+  }
+  return read;
+}
+
+/*
+ * Reads the first readLength bytes of the body, then drains the rest. The
+ * drain has to succeed without waiting for the timeout and leave the
+ * connection at the start of the next response.
+ */
+static void assertDrains(const std::string &connection, int contentLength,
+                         bool isChunked, size_t readLength,
+                         size_t burst = 0) {
+  FixtureStream upstream(connection, burst);
+  upstream.setTimeout(BODY_TIMEOUT);
+  HttpBodyStream body(upstream);
+  body.setTimeout(BODY_TIMEOUT);
+  body.reset(contentLength, isChunked);
+
+  char buffer[sizeof(BODY)];
+  TEST_ASSERT_EQUAL(readLength, body.readBytes(buffer, readLength));
+  TEST_ASSERT_EQUAL_MEMORY(BODY, buffer, readLength);
+
+  unsigned long start = millis();
+  TEST_ASSERT_TRUE(body.drain());
+  TEST_ASSERT_LESS_THAN(QUICK_MILLIS, millis() - start);
+  TEST_ASSERT_TRUE(body.finished());
+  TEST_ASSERT_EQUAL(connection.size() - strlen(NEXT_RESPONSE),
+                    upstream.position());
+}
+
+void test_reads_content_length_body() {
+  std::string connection = std::string(BODY) + NEXT_RESPONSE;
+  FixtureStream upstream(connection);
+  HttpBodyStream body(upstream);
+  body.setTimeout(BODY_TIMEOUT);
+  body.reset(strlen(BODY), false);
+  TEST_ASSERT_EQUAL_STRING(BODY, readAll(body).c_str());
+  TEST_ASSERT_TRUE(body.finished());
+}
+
+void test_reads_chunked_body() {
+  for (size_t chunkSize : {(size_t)1, (size_t)7, (size_t)16, sizeof(BODY)}) {
+    std::string connection = chunkedBody(BODY, chunkSize) + NEXT_RESPONSE;
+    FixtureStream upstream(connection);
+    HttpBodyStream body(upstream);
+    body.setTimeout(BODY_TIMEOUT);
+    body.reset(-1, true);
+    TEST_ASSERT_EQUAL_STRING(BODY, readAll(body).c_str());
+    TEST_ASSERT_TRUE(body.finished());
+  }
+}
+
+// A read of the connection per packet or chunk rather than per byte
+void test_read_bytes_reads_in_bulk() {
+  std::string body = std::string(BODY) + BODY + BODY + BODY;
+  std::string connection = chunkedBody(body, 64) + NEXT_RESPONSE;
+  FixtureStream upstream(connection, 100);
+  upstream.setTimeout(BODY_TIMEOUT);
+  HttpBodyStream bodyStream(upstream);
+  bodyStream.setTimeout(BODY_TIMEOUT);
+  bodyStream.reset(-1, true);
+
+  char buffer[4 * sizeof(BODY)] = {};
+  TEST_ASSERT_EQUAL(body.size(), bodyStream.readBytes(buffer, body.size()));
+  TEST_ASSERT_EQUAL_STRING(body.c_str(), buffer);
+  printf("%u byte body in 64 byte chunks and 100 byte packets: %u reads\n",
+         (unsigned)body.size(), (unsigned)upstream.numReads());
+  // The chunk framing is still read a byte at a time
+  TEST_ASSERT_LESS_THAN(body.size() / 4, upstream.numReads());
+  TEST_ASSERT_TRUE(bodyStream.drain());
+}
+
+void test_drains_content_length_body() {
+  std::string connection = std::string(BODY) + NEXT_RESPONSE;
+  for (size_t readLength : {(size_t)0, (size_t)10, strlen(BODY)}) {
+    assertDrains(connection, strlen(BODY), false, readLength);
+  }
+}
+
+void test_drains_empty_content_length_body() {
+  assertDrains(NEXT_RESPONSE, 0, false, 0);
+}
+
+// The body a parser leaves behind: all of the data, but not the last chunk
+void test_drains_last_chunk_after_body_is_read() {
+  for (size_t chunkSize : {(size_t)1, (size_t)7, sizeof(BODY)}) {
+    assertDrains(chunkedBody(BODY, chunkSize) + NEXT_RESPONSE, -1, true,
+                 strlen(BODY));
+  }
+}
+
+void test_drains_unread_chunks() {
+  std::string connection = chunkedBody(BODY, 7) + NEXT_RESPONSE;
+  for (size_t readLength : {(size_t)0, (size_t)3, (size_t)7, (size_t)30}) {
+    assertDrains(connection, -1, true, readLength);
+  }
+}
+
+void test_drains_chunk_extensions_and_trailer() {
+  std::string connection =
+      "10;name=value\r\n" + std::string(BODY, 16) + "\r\n" +
+      chunkedBody(BODY + 16, 9,
+                  "Expires: 0\r\nServer-Timing: db;dur=53\r\n") +
+      NEXT_RESPONSE;
+  assertDrains(connection, -1, true, 4);
+}
+
+// Data that stalls between packets is waited for, as it is still expected
+void test_drains_stalled_connection() {
+  assertDrains(chunkedBody(BODY, 7) + NEXT_RESPONSE, -1, true, 0, 5);
+  assertDrains(std::string(BODY) + NEXT_RESPONSE, strlen(BODY), false, 0, 5);
+}
+
+void test_body_without_length_cannot_be_drained() {
+  std::string connection = BODY;
+  FixtureStream upstream(connection);
+  HttpBodyStream body(upstream);
+  body.reset(-1, false);
+  TEST_ASSERT_FALSE(body.drain());
+}
+
+void test_broken_framing_cannot_be_drained() {
+  std::string connections[] = {
+      "7\r\n{\"stop\"XX0\r\n\r\n",  // data not followed by CRLF
+      "g\r\n{\"stop\"\r\n0\r\n\r\n",  // size is not hex
+      "\r\n{\"stop\"\r\n0\r\n\r\n",  // size is missing
+  };
+  for (const std::string &connection : connections) {
+    FixtureStream upstream(connection);
+    upstream.setTimeout(0);
+    HttpBodyStream body(upstream);
+    body.setTimeout(BODY_TIMEOUT);
+    body.reset(-1, true);
+    unsigned long start = millis();
+    TEST_ASSERT_FALSE(body.drain());
+    TEST_ASSERT_LESS_THAN(QUICK_MILLIS, millis() - start);
+    TEST_ASSERT_TRUE(body.finished());
+  }
+}
+
+// A connection that closes partway through the body waits for the timeout
+void test_truncated_body_cannot_be_drained() {
+  std::string chunked = chunkedBody(BODY, 7);
+  std::string connections[] = {chunked.substr(0, 20),
+                               chunked.substr(0, chunked.size() - 2)};
+  for (const std::string &connection : connections) {
+    FixtureStream upstream(connection);
+    upstream.setTimeout(50);
+    HttpBodyStream body(upstream);
+    body.setTimeout(50);
+    body.reset(-1, true);
+    TEST_ASSERT_FALSE(body.drain());
+  }
+
+  std::string partial = std::string(BODY).substr(0, 20);
+  FixtureStream upstream(partial);
+  HttpBodyStream body(upstream);
+  body.setTimeout(50);
+  body.reset(strlen(BODY), false);
+  unsigned long start = millis();
+  TEST_ASSERT_FALSE(body.drain());
+  TEST_ASSERT_GREATER_OR_EQUAL(50, millis() - start);
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_reads_content_length_body);
+  RUN_TEST(test_reads_chunked_body);
+  RUN_TEST(test_read_bytes_reads_in_bulk);
+  RUN_TEST(test_drains_content_length_body);
+  RUN_TEST(test_drains_empty_content_length_body);
+  RUN_TEST(test_drains_last_chunk_after_body_is_read);
+  RUN_TEST(test_drains_unread_chunks);
+  RUN_TEST(test_drains_chunk_extensions_and_trailer);
+  RUN_TEST(test_drains_stalled_connection);
+  RUN_TEST(test_body_without_length_cannot_be_drained);
+  RUN_TEST(test_broken_framing_cannot_be_drained);
+  RUN_TEST(test_truncated_body_cannot_be_drained);
+  return UNITY_END();
+}
@@ -0,0 +1,117 @@
+// Merging several stops' departures into one board, as Bus does by default.
+
+#include <string.h>
+#include <unity.h>
+
+#include "departures.h"
+
+#define NOW 1717401600
+
+static Departure departure(const char *route, const char *destination,
+                           time_t departureTime) {
+  Departure departure = {};
+  strlcpy(departure.route, route, sizeof(departure.route));
+  strlcpy(departure.destination, destination, sizeof(departure.destination));
+  departure.departureTime = departureTime;
+  return departure;
+}
+
+static stopDepartures stop(const char *name, int iconId) {
+  stopDepartures stop;
+  stop.description = {};
+  strlcpy(stop.description.name, name, sizeof(stop.description.name));
+  addIconId(stop.description, iconId);
+  return stop;
+}
+
+static stopDepartures emptyBoard() {
+  stopDepartures board;
+  board.description = {};
+  return board;
+}
+
+void test_same_service_within_a_minute() {
+  Departure a = departure("T2", "City", NOW);
+  TEST_ASSERT_TRUE(isSameService(a, departure("T2", "City", NOW)));
+  TEST_ASSERT_TRUE(isSameService(a, departure("T2", "City", NOW + 59)));
+  TEST_ASSERT_TRUE(isSameService(a, departure("T2", "City", NOW - 59)));
+  TEST_ASSERT_FALSE(isSameService(a, departure("T2", "City", NOW + 60)));
+  TEST_ASSERT_FALSE(isSameService(a, departure("T2", "City", NOW - 60)));
+}
+
+void test_different_route_or_destination_is_another_service() {
+  Departure a = departure("T2", "City", NOW);
+  TEST_ASSERT_FALSE(isSameService(a, departure("T3", "City", NOW)));
+  TEST_ASSERT_FALSE(isSameService(a, departure("T2", "Liverpool", NOW)));
+}
+
+void test_merge_keeps_a_shared_service_once() {
+  stopDepartures platform1 = stop("Punchbowl Platform 1", 1);
+  platform1.departures.push(departure("T3", "City", NOW + 120));
+  platform1.departures.push(departure("T3", "City", NOW + 900));
+  stopDepartures busStop = stop("Punchbowl Station", 5);
+  busStop.departures.push(departure("T3", "City", NOW + 150));
+  busStop.departures.push(departure("940", "Bankstown", NOW + 300));
+
+  stopDepartures board = emptyBoard();
+  mergeDepartures(board, platform1);
+  mergeDepartures(board, busStop);
+
+  TEST_ASSERT_EQUAL(3, board.departures.size());
+  TEST_ASSERT_EQUAL_INT64(NOW + 120, board.departures[0].departureTime);
+  TEST_ASSERT_EQUAL_STRING("940", board.departures[1].route);
+  TEST_ASSERT_EQUAL_INT64(NOW + 900, board.departures[2].departureTime);
+
+  // Named after the first stop, with every stop's modes
+  TEST_ASSERT_EQUAL_STRING("Punchbowl Platform 1", board.description.name);
+  TEST_ASSERT_EQUAL(2, board.description.numIconIds);
+  TEST_ASSERT_EQUAL(1, board.description.iconIds[0]);
+  TEST_ASSERT_EQUAL(5, board.description.iconIds[1]);
+}
+
+void test_merge_keeps_both_destinations() {
+  stopDepartures citybound = stop("Citybound", 1);
+  citybound.departures.push(departure("T3", "City", NOW + 120));
+  stopDepartures westbound = stop("Westbound", 1);
+  westbound.departures.push(departure("T3", "Liverpool", NOW + 120));
+
+  stopDepartures board = emptyBoard();
+  mergeDepartures(board, citybound);
+  mergeDepartures(board, westbound);
+
+  TEST_ASSERT_EQUAL(2, board.departures.size());
+  TEST_ASSERT_EQUAL_STRING("City", board.departures[0].destination);
+  TEST_ASSERT_EQUAL_STRING("Liverpool", board.departures[1].destination);
+}
+
+// More than MAX_DEPARTURES between the stops, interleaved in time
+void test_merge_keeps_the_earliest_departures() {
+  stopDepartures board = emptyBoard();
+  for (int i = 0; i < 3; i++) {
+    stopDepartures s = stop("Stop", 5);
+    for (int j = 0; j < MAX_DEPARTURES; j++) {
+      char route[ROUTE_NAME_LEN];
+      snprintf(route, sizeof(route), "%d", 100 * i + j);
+      s.departures.push(departure(route, "City", NOW + (3 * j + i) * 120));
+    }
+    mergeDepartures(board, s);
+  }
+
+  TEST_ASSERT_EQUAL(MAX_DEPARTURES, board.departures.size());
+  for (int k = 0; k < MAX_DEPARTURES; k++) {
+    TEST_ASSERT_EQUAL_INT64(NOW + k * 120, board.departures[k].departureTime);
+  }
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_same_service_within_a_minute);
+  RUN_TEST(test_different_route_or_destination_is_another_service);
+  RUN_TEST(test_merge_keeps_a_shared_service_once);
+  RUN_TEST(test_merge_keeps_both_destinations);
+  RUN_TEST(test_merge_keeps_the_earliest_departures);
+  return UNITY_END();
+}
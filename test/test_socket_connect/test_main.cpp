@@ -0,0 +1,112 @@
+// connectSocket() against listeners on the loopback interface.
+
+#include <Arduino.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <unity.h>
+
+#include "socket_connect.h"
+
+#define CONNECT_TIMEOUT 300
+
+// Opens a listener on a free loopback port and returns its port
+static uint16_t listenOnLoopback(int &listener, int backlog) {
+  listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  TEST_ASSERT_GREATER_OR_EQUAL(0, listener);
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  TEST_ASSERT_EQUAL(
+      0, bind(listener, (struct sockaddr *)&address, sizeof(address)));
+  TEST_ASSERT_EQUAL(0, listen(listener, backlog));
+  socklen_t length = sizeof(address);
+  getsockname(listener, (struct sockaddr *)&address, &length);
+  return ntohs(address.sin_port);
+}
+
+static int intOption(int fd, int level, int name) {
+  int value = 0;
+  socklen_t length = sizeof(value);
+  TEST_ASSERT_EQUAL(0, getsockopt(fd, level, name, &value, &length));
+  return value;
+}
+
+static long timeoutOption(int fd, int name) {
+  struct timeval tv = {};
+  socklen_t length = sizeof(tv);
+  TEST_ASSERT_EQUAL(0, getsockopt(fd, SOL_SOCKET, name, &tv, &length));
+  return tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+// The socket is set up as start_ssl_client sets up its own
+void test_connects_with_client_socket_options() {
+  int listener;
+  uint16_t port = listenOnLoopback(listener, 4);
+  int fd = connectSocket("127.0.0.1", port, CONNECT_TIMEOUT);
+  TEST_ASSERT_GREATER_OR_EQUAL(0, fd);
+
+  TEST_ASSERT_EQUAL(0, fcntl(fd, F_GETFL, 0) & O_NONBLOCK);
+  TEST_ASSERT_NOT_EQUAL(0, intOption(fd, IPPROTO_TCP, TCP_NODELAY));
+  TEST_ASSERT_NOT_EQUAL(0, intOption(fd, SOL_SOCKET, SO_KEEPALIVE));
+  TEST_ASSERT_EQUAL(CONNECT_TIMEOUT, timeoutOption(fd, SO_RCVTIMEO));
+  TEST_ASSERT_EQUAL(CONNECT_TIMEOUT, timeoutOption(fd, SO_SNDTIMEO));
+
+  // A receive with nothing sent gives up after the timeout
+  unsigned long start = millis();
+  char c;
+  TEST_ASSERT_LESS_THAN(0, recv(fd, &c, 1, 0));
+  TEST_ASSERT_INT_WITHIN(100, CONNECT_TIMEOUT, millis() - start);
+  close(fd);
+  close(listener);
+}
+
+void test_resolves_host_names() {
+  int listener;
+  uint16_t port = listenOnLoopback(listener, 4);
+  int fd = connectSocket("localhost", port, CONNECT_TIMEOUT);
+  TEST_ASSERT_GREATER_OR_EQUAL(0, fd);
+  close(fd);
+  close(listener);
+}
+
+void test_refused_connection_fails_at_once() {
+  int listener;
+  uint16_t port = listenOnLoopback(listener, 4);
+  close(listener);
+  unsigned long start = millis();
+  TEST_ASSERT_EQUAL(-1, connectSocket("127.0.0.1", port, 5000));
+  TEST_ASSERT_LESS_THAN(100, millis() - start);
+}
+
+/*
+ * A listener whose backlog is full drops further connection requests, the
+ * way an unreachable server never answers them. The connect gives up after
+ * the timeout instead of waiting for the TCP stack to.
+ */
+void test_unanswered_connection_gives_up_after_timeout() {
+  int listener;
+  uint16_t port = listenOnLoopback(listener, 0);
+  int first = connectSocket("127.0.0.1", port, CONNECT_TIMEOUT);
+  TEST_ASSERT_GREATER_OR_EQUAL(0, first);
+
+  unsigned long start = millis();
+  TEST_ASSERT_EQUAL(-1, connectSocket("127.0.0.1", port, CONNECT_TIMEOUT));
+  TEST_ASSERT_INT_WITHIN(100, CONNECT_TIMEOUT, millis() - start);
+  close(first);
+  close(listener);
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_connects_with_client_socket_options);
+  RUN_TEST(test_resolves_host_names);
+  RUN_TEST(test_refused_connection_fails_at_once);
+  RUN_TEST(test_unanswered_connection_gives_up_after_timeout);
+  return UNITY_END();
+}
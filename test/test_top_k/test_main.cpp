@@ -0,0 +1,167 @@
+// TopK against keeping every departure and sorting them.
+
+#include <unity.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "benchmark.h"
+#include "departures.h"
+#include "heap_tracking.h"
+#include "top_k.h"
+
+/*
+ * Departures as a busy station sends them: mostly in planned order, with
+ * realtime estimates moving some later, and some at the same minute.
+ */
+static std::vector<Departure> stationDepartures(int numDepartures,
+                                                unsigned seed) {
+  std::mt19937 random(seed);
+  std::vector<Departure> departures(numDepartures);
+  for (int i = 0; i < numDepartures; i++) {
+    Departure &departure = departures[i];
+    snprintf(departure.route, sizeof(departure.route), "T%d", i % 9);
+    snprintf(departure.destination, sizeof(departure.destination),
+             "Destination %d", i);
+    departure.isRealtime = random() % 2;
+    departure.departureTime = 1717401600 + i / 3 * 60 +
+                              (departure.isRealtime ? random() % 300 : 0);
+  }
+  return departures;
+}
+
+// The old path: every departure is kept, then all of them are sorted
+static std::vector<Departure> sortAll(const std::vector<Departure> &input) {
+  std::vector<Departure> kept;
+  for (const Departure &departure : input) {
+    kept.push_back(departure);
+  }
+  std::stable_sort(kept.begin(), kept.end(), departureEarlier());
+  if (kept.size() > MAX_DEPARTURES) {
+    kept.resize(MAX_DEPARTURES);
+  }
+  return kept;
+}
+
+static void assertKeepsEarliest(const std::vector<Departure> &input) {
+  std::vector<Departure> expected = sortAll(input);
+  TopK<Departure, MAX_DEPARTURES, departureEarlier> actual;
+  for (const Departure &departure : input) {
+    actual.push(departure);
+  }
+  TEST_ASSERT_EQUAL(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    // Same departure, so ties keep the order they arrived in
+    TEST_ASSERT_EQUAL_STRING(expected[i].destination,
+                             actual[i].destination);
+  }
+}
+
+void test_keeps_earliest_of_station_departures() {
+  for (int numDepartures : {0, 1, 3, 4, 5, 10, 100, 1000}) {
+    for (unsigned seed = 0; seed < 20; seed++) {
+      assertKeepsEarliest(stationDepartures(numDepartures, seed));
+    }
+  }
+}
+
+void test_keeps_earliest_in_any_order() {
+  std::vector<Departure> departures = stationDepartures(50, 1);
+  std::sort(departures.begin(), departures.end(), departureEarlier());
+  assertKeepsEarliest(departures);
+  std::reverse(departures.begin(), departures.end());
+  assertKeepsEarliest(departures);
+
+  // Every departure at the same time
+  for (Departure &departure : departures) {
+    departure.departureTime = 1717401600;
+  }
+  assertKeepsEarliest(departures);
+}
+
+void test_push_reports_whether_kept() {
+  TopK<int, 2> topK;
+  TEST_ASSERT_TRUE(topK.push(5));
+  TEST_ASSERT_TRUE(topK.push(7));
+  TEST_ASSERT_FALSE(topK.push(7));
+  TEST_ASSERT_FALSE(topK.push(9));
+  TEST_ASSERT_TRUE(topK.push(1));
+  TEST_ASSERT_EQUAL(1, topK[0]);
+  TEST_ASSERT_EQUAL(5, topK[1]);
+  topK.clear();
+  TEST_ASSERT_TRUE(topK.empty());
+}
+
+// Picking the departures shown takes no heap, however many are sent
+void test_never_allocates() {
+  if (!heapTrackingAvailable()) {
+    TEST_IGNORE_MESSAGE("heap tracking needs glibc");
+  }
+  for (int numDepartures : {10, 100, 300, 1000}) {
+    std::vector<Departure> input = stationDepartures(numDepartures, 7);
+    long topKHeap = peakHeapUsed([&]() {
+      TopK<Departure, MAX_DEPARTURES, departureEarlier> topK;
+      for (const Departure &departure : input) {
+        topK.push(departure);
+      }
+    });
+    TEST_ASSERT_EQUAL(0, topKHeap);
+  }
+}
+
+#ifdef BENCHMARK
+/*
+ * Time and the most heap held at once to pick the departures shown from 10 to
+ * 1000 stop events.
+ */
+void test_benchmark_against_sorting_all() {
+  for (int numDepartures : {10, 100, 300, 1000}) {
+    std::vector<Departure> input = stationDepartures(numDepartures, 7);
+    const int runs = 200;
+    time_t sum = 0;
+
+    double sortMicros = microsPerRun(runs, [&]() {
+      sum += sortAll(input)[0].departureTime;
+    });
+    double topKMicros = microsPerRun(runs, [&]() {
+      TopK<Departure, MAX_DEPARTURES, departureEarlier> topK;
+      for (const Departure &departure : input) {
+        topK.push(departure);
+      }
+      sum -= topK[0].departureTime;
+    });
+    TEST_ASSERT_EQUAL_INT64(0, sum);
+
+    long sortHeap = peakHeapUsed([&]() { sortAll(input); });
+    long topKHeap = peakHeapUsed([&]() {
+      TopK<Departure, MAX_DEPARTURES, departureEarlier> topK;
+      for (const Departure &departure : input) {
+        topK.push(departure);
+      }
+    });
+
+    printf("%4d departures: sort all %8.2f us %6ld bytes heap, top %d "
+           "%8.2f us %6ld bytes heap\n",
+           numDepartures, sortMicros, sortHeap, MAX_DEPARTURES, topKMicros,
+           topKHeap);
+  }
+  printf("TopK holds %u bytes whatever the number of departures\n",
+         (unsigned)sizeof(TopK<Departure, MAX_DEPARTURES, departureEarlier>));
+}
+#endif
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_keeps_earliest_of_station_departures);
+  RUN_TEST(test_keeps_earliest_in_any_order);
+  RUN_TEST(test_push_reports_whether_kept);
+  RUN_TEST(test_never_allocates);
+#ifdef BENCHMARK
+  RUN_TEST(test_benchmark_against_sorting_all);
+#endif
+  return UNITY_END();
+}
@@ -0,0 +1,201 @@
+// parseTimeUtc() against the C library's timegm() and gmtime().
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unity.h>
+
+#include "benchmark.h"
+#include "departures.h"
+
+#define TIME_STRING_LEN 80  // room for any int fields, not just valid ones
+
+static void formatTime(const struct tm &tm, char buffer[TIME_STRING_LEN]) {
+  snprintf(buffer, TIME_STRING_LEN, "%04d-%02d-%02dT%02d:%02d:%02dZ", tm.tm_year + 1900,
+           tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+}
+
+static void assertMatchesGmtime(time_t time) {
+  struct tm tm;
+  TEST_ASSERT_NOT_NULL(gmtime_r(&time, &tm));
+  char buffer[TIME_STRING_LEN];
+  formatTime(tm, buffer);
+  TEST_ASSERT_EQUAL_INT64_MESSAGE(time, parseTimeUtc(buffer), buffer);
+}
+
+static void assertMatchesTimegm(int year, int month, int day, int hour,
+                                int minute, int second) {
+  struct tm tm = {};
+  tm.tm_year = year - 1900;
+  tm.tm_mon = month - 1;
+  tm.tm_mday = day;
+  tm.tm_hour = hour;
+  tm.tm_min = minute;
+  tm.tm_sec = second;
+  char buffer[TIME_STRING_LEN];
+  formatTime(tm, buffer);
+  TEST_ASSERT_EQUAL_INT64_MESSAGE(timegm(&tm), parseTimeUtc(buffer), buffer);
+}
+
+// Every hour from 1900 to 2200, each at a different minute and second
+void test_every_hour() {
+  const time_t first = -2208988800;  // 1900-01-01T00:00:00Z
+  const time_t last = 7258118400;    // 2200-01-01T00:00:00Z
+  for (time_t hour = first; hour < last; hour += 3600) {
+    time_t offset = (hour / 3600 * 7919) % 3600;
+    assertMatchesGmtime(hour + (offset < 0 ? offset + 3600 : offset));
+  }
+}
+
+// Every second of the days around a leap day and around the end of a year
+void test_every_second() {
+  const time_t starts[] = {
+      1709078400,  // 2024-02-28T00:00:00Z
+      1735603200,  // 2024-12-31T00:00:00Z
+      951696000,   // 2000-02-28T00:00:00Z
+  };
+  for (time_t start : starts) {
+    for (time_t time = start; time < start + 2 * 86400; time++) {
+      assertMatchesGmtime(time);
+    }
+  }
+}
+
+// The first and last day of every month of every four digit year
+void test_every_month() {
+  static const int daysInMonth[] = {31, 29, 31, 30, 31, 30,
+                                    31, 31, 30, 31, 30, 31};
+  for (int year = 0; year <= 9999; year++) {
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    for (int month = 1; month <= 12; month++) {
+      int lastDay = month == 2 && !leap ? 28 : daysInMonth[month - 1];
+      assertMatchesTimegm(year, month, 1, 0, 0, 0);
+      assertMatchesTimegm(year, month, lastDay, 23, 59, 59);
+    }
+  }
+}
+
+// Fields that are in range but past the end of the month or minute roll over
+// the same way timegm() normalizes them
+void test_rolls_over_like_timegm() {
+  assertMatchesTimegm(2023, 2, 29, 12, 0, 0);
+  assertMatchesTimegm(2024, 2, 31, 12, 0, 0);
+  assertMatchesTimegm(2024, 4, 31, 0, 0, 0);
+  assertMatchesTimegm(2016, 12, 31, 23, 59, 60);
+}
+
+void test_rejects_other_formats() {
+  const char *invalid[] = {
+      "",
+      "2024",
+      "2024-06-03",
+      "2024-06-03T08:00:00",
+      "2024-06-03T08:00:00+10:00",
+      "2024-06-03 08:00:00Z",
+      "2024/06/03T08:00:00Z",
+      "2024-6-03T08:00:00Z",
+      "24-06-03T08:00:00Z",
+      "2024-06-03T08:00Z",
+      "2024-06-03t08:00:00z",
+      "2024-0a-03T08:00:00Z",
+      " 2024-06-03T08:00:00Z",
+      "2024-00-03T08:00:00Z",
+      "2024-13-03T08:00:00Z",
+      "2024-06-00T08:00:00Z",
+      "2024-06-32T08:00:00Z",
+      "2024-06-03T24:00:00Z",
+      "2024-06-03T08:60:00Z",
+      "2024-06-03T08:00:61Z",
+  };
+  for (const char *s : invalid) {
+    TEST_ASSERT_EQUAL_INT64_MESSAGE(0, parseTimeUtc(s), s);
+  }
+}
+
+// Every character of a valid timestamp, replaced by each other character
+void test_rejects_every_single_character_change() {
+  const char valid[] = "2024-06-03T08:00:00Z";
+  const char *digits = "dddd-dd-ddTdd:dd:ddZ";
+  for (size_t i = 0; i < sizeof(valid) - 1; i++) {
+    for (int c = 1; c < 256; c++) {
+      bool isDigit = c >= '0' && c <= '9';
+      if (digits[i] == 'd' ? isDigit : c == valid[i]) {
+        continue;
+      }
+      char changed[sizeof(valid)];
+      memcpy(changed, valid, sizeof(valid));
+      changed[i] = (char)c;
+      TEST_ASSERT_EQUAL_INT64_MESSAGE(0, parseTimeUtc(changed), changed);
+    }
+  }
+}
+
+#ifdef BENCHMARK
+/*
+ * The decoder against strptime() with mktime(), which it replaced, and with
+ * timegm().
+ */
+void test_benchmark() {
+  const int numTimes = 1000;
+  static char times[numTimes][TIME_STRING_LEN];
+  for (int i = 0; i < numTimes; i++) {
+    time_t time = 1717401600 + (time_t)i * 157;
+    struct tm tm;
+    gmtime_r(&time, &tm);
+    formatTime(tm, times[i]);
+  }
+  const int runs = 200;
+  long long sum = 0;
+
+  double decoderMicros = microsPerRun(runs, [&]() {
+    for (int i = 0; i < numTimes; i++) {
+      sum += parseTimeUtc(times[i]);
+    }
+  });
+  double mktimeMicros = microsPerRun(runs, [&]() {
+    for (int i = 0; i < numTimes; i++) {
+      struct tm tm = {};
+      strptime(times[i], "%Y-%m-%dT%H:%M:%SZ", &tm);
+      sum -= mktime(&tm);
+    }
+  });
+  double timegmMicros = microsPerRun(runs, [&]() {
+    for (int i = 0; i < numTimes; i++) {
+      struct tm tm = {};
+      strptime(times[i], "%Y-%m-%dT%H:%M:%SZ", &tm);
+      sum += timegm(&tm);
+    }
+  });
+
+  printf("Per timestamp: parseTimeUtc %6.1f ns, strptime and mktime %6.1f ns, "
+         "strptime and timegm %6.1f ns\n",
+         decoderMicros * 1000 / numTimes, mktimeMicros * 1000 / numTimes,
+         timegmMicros * 1000 / numTimes);
+  // TZ is UTC, so all three decode the same times
+  long long expected = 0;
+  for (int i = 0; i < numTimes; i++) {
+    expected += parseTimeUtc(times[i]);
+  }
+  TEST_ASSERT_EQUAL_INT64(expected * runs, sum);
+}
+#endif
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+  setenv("TZ", "UTC", 1);
+  tzset();
+  UNITY_BEGIN();
+  RUN_TEST(test_every_hour);
+  RUN_TEST(test_every_second);
+  RUN_TEST(test_every_month);
+  RUN_TEST(test_rolls_over_like_timegm);
+  RUN_TEST(test_rejects_other_formats);
+  RUN_TEST(test_rejects_every_single_character_change);
+#ifdef BENCHMARK
+  RUN_TEST(test_benchmark);
+#endif
+  return UNITY_END();
+}
@@ -0,0 +1,180 @@
+// Streaming OpenWeather current weather parsing against reading the whole
+// body into a string and parsing it unfiltered.
+
+#include <ArduinoJson.h>
+#include <unity.h>
+
+#include <string>
+
+#include "benchmark.h"
+#include "fixture_stream.h"
+#include "heap_tracking.h"
+#include "weather_fixtures.h"
+#include "weather_report.h"
+
+// The fields the old path kept, each in its own string on the heap
+struct oldWeather {
+  std::string cityName;
+  float temperature;
+  float feelsLike;
+  int humidity;
+  std::string weatherDescription;
+  std::string weatherIconCode;
+};
+
+/*
+ * The old path: http.getString() copies the whole body into a string, which
+ * is then parsed into an unfiltered document.
+ */
+static bool parseFromString(Stream &stream, size_t contentLength,
+                            oldWeather &result) {
+  std::string payload;
+  payload.reserve(contentLength);
+  char buffer[128];
+  size_t n;
+  while ((n = stream.readBytes(buffer, sizeof(buffer))) > 0) {
+    payload.append(buffer, n);
+  }
+  JsonDocument doc;
+  if (deserializeJson(doc, payload)) {
+    return false;
+  }
+  result.cityName = doc["name"].as<const char *>();
+  result.temperature = doc["main"]["temp"];
+  result.feelsLike = doc["main"]["feels_like"];
+  result.humidity = doc["main"]["humidity"];
+  result.weatherDescription =
+      doc["weather"][0]["description"].as<const char *>();
+  result.weatherIconCode = doc["weather"][0]["icon"].as<const char *>();
+  return true;
+}
+
+void test_parses_current_conditions() {
+  std::string response = currentWeatherResponse();
+  FixtureStream stream(response);
+  weatherReport report = {};
+  TEST_ASSERT_TRUE(parseWeather(stream, report));
+  TEST_ASSERT_EQUAL_STRING("Punchbowl", report.cityName);
+  TEST_ASSERT_EQUAL_FLOAT(18.52f, report.temperature);
+  TEST_ASSERT_EQUAL_FLOAT(18.1f, report.feelsLike);
+  TEST_ASSERT_EQUAL(71, report.humidity);
+  TEST_ASSERT_EQUAL_STRING("light rain", report.weatherDescription);
+  TEST_ASSERT_EQUAL_STRING("10d", report.weatherIconCode);
+}
+
+void test_matches_string_path() {
+  std::string response = currentWeatherResponse();
+  oldWeather expected;
+  FixtureStream expectedStream(response);
+  expectedStream.setTimeout(0);
+  TEST_ASSERT_TRUE(
+      parseFromString(expectedStream, response.size(), expected));
+
+  FixtureStream stream(response, 100);
+  weatherReport actual = {};
+  TEST_ASSERT_TRUE(parseWeather(stream, actual));
+  TEST_ASSERT_EQUAL_STRING(expected.cityName.c_str(), actual.cityName);
+  TEST_ASSERT_EQUAL_FLOAT(expected.temperature, actual.temperature);
+  TEST_ASSERT_EQUAL_FLOAT(expected.feelsLike, actual.feelsLike);
+  TEST_ASSERT_EQUAL(expected.humidity, actual.humidity);
+  TEST_ASSERT_EQUAL_STRING(expected.weatherDescription.c_str(),
+                           actual.weatherDescription);
+  TEST_ASSERT_EQUAL_STRING(expected.weatherIconCode.c_str(),
+                           actual.weatherIconCode);
+}
+
+void test_long_description_is_cut_to_fit() {
+  std::string description(WEATHER_DESCRIPTION_LEN * 2, 'x');
+  std::string response = currentWeatherResponse(description.c_str());
+  FixtureStream stream(response);
+  weatherReport report = {};
+  TEST_ASSERT_TRUE(parseWeather(stream, report));
+  TEST_ASSERT_EQUAL(WEATHER_DESCRIPTION_LEN - 1,
+                    strlen(report.weatherDescription));
+}
+
+void test_truncated_response_fails() {
+  std::string response = currentWeatherResponse();
+  response.resize(response.size() / 2);
+  FixtureStream stream(response);
+  stream.setTimeout(0);
+  weatherReport report = {};
+  TEST_ASSERT_FALSE(parseWeather(stream, report));
+}
+
+// The most heap held at once is less than the string and unfiltered document
+void test_heap_stays_below_string_path() {
+  if (!heapTrackingAvailable()) {
+    TEST_IGNORE_MESSAGE("heap tracking needs glibc");
+  }
+  std::string response = currentWeatherResponse();
+  // The first parse builds the filter, which is then kept for every cycle
+  long stringHeap = peakHeapUsed([&]() {
+    oldWeather weather;
+    FixtureStream stream(response);
+    stream.setTimeout(0);
+    parseFromString(stream, response.size(), weather);
+  });
+  long streamHeap = peakHeapUsed([&]() {
+    weatherReport report;
+    FixtureStream stream(response);
+    parseWeather(stream, report);
+  });
+  TEST_ASSERT_LESS_THAN(stringHeap, streamHeap);
+}
+
+#ifdef BENCHMARK
+/*
+ * The most heap held at once and the time to parse the response, streamed
+ * against the copy in a string and the unfiltered document.
+ */
+void test_benchmark_against_string_path() {
+  std::string response = currentWeatherResponse();
+  const int runs = 200;
+
+  double stringMicros = microsPerRun(runs, [&]() {
+    oldWeather weather;
+    FixtureStream stream(response);
+    stream.setTimeout(0);
+    parseFromString(stream, response.size(), weather);
+  });
+  double streamMicros = microsPerRun(runs, [&]() {
+    weatherReport report;
+    FixtureStream stream(response);
+    parseWeather(stream, report);
+  });
+
+  long stringHeap = peakHeapUsed([&]() {
+    oldWeather weather;
+    FixtureStream stream(response);
+    stream.setTimeout(0);
+    parseFromString(stream, response.size(), weather);
+  });
+  long streamHeap = peakHeapUsed([&]() {
+    weatherReport report;
+    FixtureStream stream(response);
+    parseWeather(stream, report);
+  });
+
+  printf("%u byte response: string and unfiltered document %7.1f us %5ld "
+         "bytes peak, streamed %7.1f us %5ld bytes peak\n",
+         (unsigned)response.size(), stringMicros, stringHeap, streamMicros,
+         streamHeap);
+}
+#endif
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_parses_current_conditions);
+  RUN_TEST(test_matches_string_path);
+  RUN_TEST(test_long_description_is_cut_to_fit);
+  RUN_TEST(test_truncated_response_fails);
+  RUN_TEST(test_heap_stays_below_string_path);
+#ifdef BENCHMARK
+  RUN_TEST(test_benchmark_against_string_path);
+#endif
+  return UNITY_END();
+}
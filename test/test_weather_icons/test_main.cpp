@@ -0,0 +1,77 @@
+// The weather icon looked up for every documented OpenWeather icon code.
+
+#include <unity.h>
+
+#include "weather_icons.h"
+
+struct documentedCode {
+  const char *code;
+  const char *label;
+};
+
+// https://openweathermap.org/weather-conditions, each with a d and n variant
+static const documentedCode DOCUMENTED_CODES[] = {
+    {"01", "clear sky"},   {"02", "few clouds"},    {"03", "scattered clouds"},
+    {"04", "broken clouds"}, {"09", "shower rain"}, {"10", "rain"},
+    {"11", "thunderstorm"}, {"13", "snow"},         {"50", "mist"},
+};
+
+// Set bits in a 32x32 icon, which draws them black
+static int inkedPixels(const unsigned char *bitmap) {
+  int count = 0;
+  for (int i = 0; i < WEATHER_ICON_BYTES; i++) {
+    count += __builtin_popcount(bitmap[i]);
+  }
+  return count;
+}
+
+void test_every_documented_code_has_an_icon() {
+  for (const documentedCode &documented : DOCUMENTED_CODES) {
+    for (char variant : {'d', 'n'}) {
+      char code[4] = {documented.code[0], documented.code[1], variant, '\0'};
+      const weatherIconInfo *icon = getWeatherIcon(code);
+      TEST_ASSERT_NOT_NULL_MESSAGE(icon, code);
+      TEST_ASSERT_EQUAL_STRING_MESSAGE(documented.label, icon->label, code);
+      TEST_ASSERT_EQUAL_MESSAGE(variant == 'n', icon->isNight, code);
+      TEST_ASSERT_EQUAL_PTR_MESSAGE(icon->bitmap, getWeatherBitmap(code),
+                                    code);
+    }
+  }
+}
+
+/*
+ * Every bitmap is a whole 32x32 icon with a picture in it: neither blank nor
+ * a solid block.
+ */
+void test_every_icon_is_a_whole_picture() {
+  const int numPixels = WEATHER_ICON_WIDTH * WEATHER_ICON_HEIGHT;
+  TEST_ASSERT_EQUAL(numPixels / 8, WEATHER_ICON_BYTES);
+  for (const documentedCode &documented : DOCUMENTED_CODES) {
+    char code[4] = {documented.code[0], documented.code[1], 'd', '\0'};
+    const unsigned char *bitmap = getWeatherBitmap(code);
+    int inked = inkedPixels(bitmap);
+    TEST_ASSERT_GREATER_THAN_MESSAGE(numPixels / 2, inked, code);
+    TEST_ASSERT_LESS_THAN_MESSAGE(numPixels, inked, code);
+  }
+}
+
+void test_unknown_codes_have_no_icon() {
+  for (const char *code : {"", "0", "01", "00d", "05d", "12n", "49d", "51d",
+                           "99n", "01x", "01D", "1d", "01dd", "a1d", "0ad"}) {
+    TEST_ASSERT_NULL_MESSAGE(getWeatherIcon(code), code);
+    // Drawn as clear sky rather than left out
+    TEST_ASSERT_EQUAL_PTR_MESSAGE(epd_bitmap_clear_sky, getWeatherBitmap(code),
+                                  code);
+  }
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_every_documented_code_has_an_icon);
+  RUN_TEST(test_every_icon_is_a_whole_picture);
+  RUN_TEST(test_unknown_codes_have_no_icon);
+  return UNITY_END();
+}
@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+"""A local stand-in for the TfNSW and OpenWeather HTTPS servers.
+
+Serves a small JSON body over TLS 1.2 with session resumption, behind a relay
+that holds every packet back by half of --rtt, so that handshake times are
+dominated by round trips the way they are over WiFi.
+
+Point a fetch URL at the printed address to time the device against it, or
+run with --measure to time full and resumed handshakes from this host:
+
+    python3 test/tls_stand_in.py --rtt 100 --measure 20
+"""
+
+import argparse
+import os
+import socket
+import socketserver
+import ssl
+import statistics
+import subprocess
+import tempfile
+import threading
+import time
+
+BODY = b'{"stopEvents":[]}'
+RESPONSE = (b"HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+            b"Content-Length: %d\r\n\r\n%s" % (len(BODY), BODY))
+
+
+def server_context(directory):
+    cert = os.path.join(directory, "cert.pem")
+    key = os.path.join(directory, "key.pem")
+    subprocess.run(
+        ["openssl", "req", "-x509", "-newkey", "ec", "-pkeyopt",
+         "ec_paramgen_curve:prime256v1", "-nodes", "-days", "1", "-subj",
+         "/CN=localhost", "-keyout", key, "-out", cert],
+        check=True, capture_output=True)
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    # As the ESP32's mbedtls negotiates
+    context.maximum_version = ssl.TLSVersion.TLSv1_2
+    context.load_cert_chain(cert, key)
+    return context
+
+
+class HttpsHandler(socketserver.BaseRequestHandler):
+    def handle(self):
+        try:
+            with self.server.context.wrap_socket(
+                    self.request, server_side=True) as tls:
+                request = b""
+                while True:
+                    data = tls.recv(4096)
+                    if not data:
+                        return
+                    request += data
+                    while b"\r\n\r\n" in request:
+                        _, request = request.split(b"\r\n\r\n", 1)
+                        tls.sendall(RESPONSE)
+        except (ssl.SSLError, OSError):
+            pass
+
+
+class HttpsServer(socketserver.ThreadingTCPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+
+    def __init__(self, address, context):
+        super().__init__(address, HttpsHandler)
+        self.context = context
+
+
+def pipe(source, destination, delay):
+    try:
+        while True:
+            data = source.recv(65536)
+            if not data:
+                break
+            time.sleep(delay)
+            destination.sendall(data)
+    except OSError:
+        pass
+    finally:
+        for s in (source, destination):
+            try:
+                s.shutdown(socket.SHUT_RDWR)
+            except OSError:
+                pass
+
+
+class RelayHandler(socketserver.BaseRequestHandler):
+    def handle(self):
+        upstream = socket.create_connection(self.server.upstream)
+        for s in (self.request, upstream):
+            s.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        delay = self.server.rtt / 2000
+        # The relay's own connect stands in for the TCP handshake's round trip
+        time.sleep(2 * delay)
+        back = threading.Thread(target=pipe,
+                                args=(upstream, self.request, delay))
+        back.start()
+        pipe(self.request, upstream, delay)
+        back.join()
+        upstream.close()
+
+
+class Relay(socketserver.ThreadingTCPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+
+    def __init__(self, address, upstream, rtt):
+        super().__init__(address, RelayHandler)
+        self.upstream = upstream
+        self.rtt = rtt
+
+
+def handshake_millis(port, context, session=None):
+    start = time.perf_counter()
+    with socket.create_connection(("127.0.0.1", port)) as raw:
+        raw.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        with context.wrap_socket(raw, server_hostname="localhost",
+                                 session=session) as tls:
+            elapsed = (time.perf_counter() - start) * 1000
+            tls.sendall(b"GET / HTTP/1.1\r\nHost: localhost\r\n\r\n")
+            tls.recv(4096)
+            return elapsed, tls.session, tls.session_reused
+
+
+def measure(port, runs):
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_CLIENT)
+    context.check_hostname = False
+    context.verify_mode = ssl.CERT_NONE
+    context.maximum_version = ssl.TLSVersion.TLSv1_2
+
+    full, resumed = [], []
+    _, session, _ = handshake_millis(port, context)
+    for _ in range(runs):
+        elapsed, _, reused = handshake_millis(port, context)
+        assert not reused
+        full.append(elapsed)
+        elapsed, _, reused = handshake_millis(port, context, session)
+        assert reused, "the stand-in did not resume the session"
+        resumed.append(elapsed)
+    print("connect and handshake over %d runs: full %.1f ms median, "
+          "resumed %.1f ms median" % (runs, statistics.median(full),
+                                      statistics.median(resumed)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--port", type=int, default=8443)
+    parser.add_argument("--rtt", type=int, default=0,
+                        help="round trip time to add, in millis")
+    parser.add_argument("--measure", type=int, metavar="RUNS",
+                        help="time handshakes from this host, then exit")
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as directory:
+        https = HttpsServer(("127.0.0.1", 0), server_context(directory))
+        relay = Relay(("0.0.0.0", 0 if args.measure else args.port),
+                      https.server_address, args.rtt)
+        for server in (https, relay):
+            threading.Thread(target=server.serve_forever, daemon=True).start()
+        port = relay.server_address[1]
+        if args.measure:
+            measure(port, args.measure)
+            return
+        print("Serving https://<this host>:%d/ with %d ms added round trip "
+              "time" % (port, args.rtt))
+        try:
+            threading.Event().wait()
+        except KeyboardInterrupt:
+            pass
+
+
+if __name__ == "__main__":
+    main()